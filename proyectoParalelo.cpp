@@ -4,11 +4,38 @@
 #include <fstream>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <omp.h>
 #include <list>     
 #include <unistd.h>  
 #include <termios.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <new>
+#include <numeric>
+#include <memory>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+#include <cerrno>
+#ifdef INSTRUMENTACION
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 using namespace std;
 
 const int VACIO = 0;
@@ -16,10 +43,72 @@ const int CONEJO = 1;
 const int ZORRO = 2;
 const int ROCA = 3;
 
+const size_t LINEA_CACHE = 64;
+
+// Asignador que alinea el bloque de memoria al inicio de una línea de caché
+template <typename T>
+struct AsignadorAlineado {
+    typedef T value_type;
+
+    AsignadorAlineado() = default;
+    template <typename U> AsignadorAlineado(const AsignadorAlineado<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(LINEA_CACHE)));
+    }
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, align_val_t(LINEA_CACHE));
+    }
+
+    template <typename U> bool operator==(const AsignadorAlineado<U> &) const { return true; }
+    template <typename U> bool operator!=(const AsignadorAlineado<U> &) const { return false; }
+};
+
+// Rejilla plana en orden por filas con un borde de una celda alrededor del mundo.
+// Las celdas (-1, j), (filas, j), (i, -1) e (i, columnas) existen, así que los
+// vecinos de cualquier celda válida se pueden leer sin comprobar límites.
+// Cada fila ocupa un número entero de líneas de caché.
+template <typename T>
+struct Rejilla {
+    int filas = 0;
+    int columnas = 0;
+    size_t paso = 0;  // Elementos por fila, incluyendo borde y relleno
+    vector<T, AsignadorAlineado<T>> celdas;
+
+    void redimensionar(int num_filas, int num_columnas, T valor, T valor_borde) {
+        filas = num_filas;
+        columnas = num_columnas;
+
+        // Redondear el paso para que cada fila empiece en una línea de caché
+        size_t multiplo = LINEA_CACHE / gcd(LINEA_CACHE, sizeof(T));
+        paso = ((size_t)columnas + 2 + multiplo - 1) / multiplo * multiplo;
+
+        celdas.assign(paso * (filas + 2), valor_borde);
+
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            T *f = fila(i);
+            for (int j = 0; j < columnas; j++) {
+                f[j] = valor;
+            }
+        }
+    }
+
+    size_t indice(int i, int j) const { return (size_t)(i + 1) * paso + (j + 1); }
+
+    T &operator()(int i, int j) { return celdas[indice(i, j)]; }
+    const T &operator()(int i, int j) const { return celdas[indice(i, j)]; }
+
+    // Puntero a la celda (i, 0); las posiciones -1 y columnas son el borde
+    T *fila(int i) { return &celdas[indice(i, 0)]; }
+    const T *fila(int i) const { return &celdas[indice(i, 0)]; }
+};
+
+// El borde del mundo se marca como roca para que nunca sea un destino posible
 struct Mundo {
     int filas;
     int columnas;
-    vector<vector<int>> matriz;
+    Rejilla<uint8_t> matriz;
 };
 
 struct Conejo {
@@ -35,6 +124,65 @@ struct Zorro {
     int hambre;
 };
 
+// Orden de filas de los animales, el de los vectores que entregan los motores
+struct PorPosicion {
+    template <typename Animal>
+    bool operator()(const Animal &a, const Animal &b) const {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    }
+};
+const PorPosicion por_posicion = {};
+
+// Motores de simulación disponibles
+const int MOTOR_ENTIDADES = 0;    // Recorre los animales y escribe en su destino
+const int MOTOR_RECOLECCION = 1;  // Cada celda lee a sus vecinos y solo se escribe a sí misma
+const int MOTOR_BITBOARD = 2;     // Planos de bits por especie y listas ordenadas de animales
+const int MOTOR_TESELAS = 3;      // Un rectángulo del mundo por hilo, con halo de una celda
+const int MOTOR_DISTRIBUIDO = 4;  // Franjas de filas en procesos distintos
+const int MOTOR_REFERENCIA = 5;   // Secuencial, igual que proyecto.cpp
+const int MOTOR_DISPERSO = 6;     // Trozos que solo existen donde hay animales o rocas
+const int MOTOR_COMPACTO = 7;     // Estado y animal empaquetados por celda, sin vectores
+const int MOTOR_ESPECIES = 8;     // Red trófica general, aquí con conejos y zorros
+const char *const NOMBRES_MOTORES[] = {"entidades", "recoleccion", "bitboard", "teselas", "distribuido", "referencia", "disperso", "compacto", "especies"};
+const int NUM_MOTORES = 9;
+
+// Variantes del motor de entidades: vecinos de cada celda y qué hay más allá
+// del borde del mundo
+const int VECINDAD_VON_NEUMANN = 0;  // Cuatro vecinos
+const int VECINDAD_MOORE = 1;        // Ocho vecinos, con las diagonales
+const char *const NOMBRES_VECINDADES[] = {"von-neumann", "moore"};
+const int CONTORNO_ACOTADO = 0;      // Roca alrededor del mundo
+const int CONTORNO_TOROIDAL = 1;     // Los bordes opuestos se tocan
+const char *const NOMBRES_CONTORNOS[] = {"acotado", "toroidal"};
+
+// Las variantes las tienen el motor de entidades y el de referencia que lo verifica
+inline bool admite_vecindad(int vecindad, int contorno, int motor) {
+    return (vecindad == VECINDAD_VON_NEUMANN && contorno == CONTORNO_ACOTADO)
+        || motor == MOTOR_ENTIDADES || motor == MOTOR_REFERENCIA;
+}
+
+// Clave de prioridad con la que un sobreviviente reclama su celda de destino.
+// La edad de reproducción va en la parte alta y el hambre invertida en la baja,
+// así la clave mayor es la del animal que gana el conflicto: más edad y, a igual
+// edad, menos hambre. Una clave 0 indica que la celda no fue reclamada.
+inline uint64_t clave_prioridad(int edad_reproduccion, int hambre) {
+    return ((uint64_t)(edad_reproduccion + 1) << 32) | (uint32_t)(UINT32_MAX - (uint32_t)hambre);
+}
+
+inline int edad_de_clave(uint64_t clave) {
+    return (int)(clave >> 32) - 1;
+}
+
+inline int hambre_de_clave(uint64_t clave) {
+    return (int)(UINT32_MAX - (uint32_t)clave);
+}
+
+// Reclama la celda con un máximo atómico; sustituye a la sección crítica
+inline void reclamar_celda(uint64_t &celda, uint64_t clave) {
+    #pragma omp atomic compare
+    if (celda < clave) { celda = clave; }
+}
+
 struct Parametros {
     int gen_proc_conejos = 0;  // Generaciones hasta que un conejo puede procrear
     int gen_proc_zorros;       // Generaciones hasta que un zorro puede procrear
@@ -42,8 +190,390 @@ struct Parametros {
     int num_generaciones;      // Número de generaciones para la simulación
     int num_hilos;             // Número de hilos para la paralelización
     int num_objetos;           // Cantidad de elementos del mundo
+    int motor = MOTOR_ENTIDADES; // Motor de simulación elegido
+    int num_procesos = 2;      // Procesos del motor distribuido
+    int vecindad = VECINDAD_VON_NEUMANN; // Solo cambia en el motor de entidades
+    int contorno = CONTORNO_ACOTADO;
+};
+
+// Opciones de la ejecución que no afectan a la simulación
+struct Opciones {
+    string trayectoria;         // Archivo de trayectoria, vacío si no se graba
+    int cada = 1;               // Generaciones entre cuadros de la trayectoria
+    string puntos_control;      // Archivo del último punto de control, vacío si no se guardan
+    int cada_control = 100;     // Generaciones entre puntos de control
+    string medidas;             // JSON de la instrumentación, vacío si no se exporta
+    bool parametros = false;    // Parámetros dados con --parametros, no se preguntan
+    int modo = 0;               // 1 controles, 2 respuesta inmediata, 0 preguntar
+    bool salida_binaria = false; // Salida en formato de instantánea en vez de texto
+    bool silencioso = false;    // No dibujar el mundo final en la consola
+};
+
+// Instrumentación del camino caliente. Solo existe si se compila con
+// -DINSTRUMENTACION; sin ella las macros no generan código.
+//   MEDIR_FASE(f)  tiempo de pared de la fase hasta el final del bloque, desde
+//                  fuera de la región paralela
+//   INICIAR_FASE(f) / TERMINAR_FASE(f)  lo mismo para un tramo de una función
+//   MEDIR_HILO(f)  tiempo ocupado de cada hilo, dentro de la región paralela
+//                  y delante de un "omp for nowait" (la espera en la barrera
+//                  final cuenta como tiempo inactivo)
+//   CONTAR(c, n)   suma n al contador c del hilo que lo llama
+//   SINCRONIZAR(m) espera a que el motor m termine lo pedido, para que la fase
+//                  mida la simulación y no solo el envío de órdenes
+#ifdef INSTRUMENTACION
+enum FaseMedida {
+    FASE_GENERACION,
+    FASE_INICIALIZAR_EDAD,
+    FASE_MOVER_CONEJOS,
+    FASE_RECOGER_CONEJOS,
+    FASE_MOVER_ZORROS,
+    FASE_CONEJOS_COMIDOS,
+    FASE_RECOGER_ZORROS,
+    NUM_FASES
+};
+const char *const NOMBRES_FASES[NUM_FASES] = {
+    "generacion", "inicializar_edad", "mover_conejos", "recoger_conejos",
+    "mover_zorros", "conejos_comidos", "recoger_zorros"
+};
+
+enum ContadorMedido {
+    CONTADOR_MOVIMIENTOS,
+    CONTADOR_NACIMIENTOS,
+    CONTADOR_DEPREDACIONES,
+    CONTADOR_HAMBRUNAS,
+    CONTADOR_RECLAMOS,          // Animales que reclaman una celda
+    CONTADOR_CELDAS_RECLAMADAS, // Celdas con al menos un reclamo
+    NUM_CONTADORES
+};
+const char *const NOMBRES_CONTADORES[NUM_CONTADORES] = {
+    "movimientos", "nacimientos", "depredaciones", "hambrunas", "reclamos", "celdas_reclamadas"
+};
+
+// Contadores de hardware por hilo, si el núcleo deja abrirlos
+const int NUM_EVENTOS_HW = 4;
+const uint64_t EVENTOS_HW[NUM_EVENTOS_HW] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+const char *const NOMBRES_EVENTOS_HW[NUM_EVENTOS_HW] = {"ciclos", "instrucciones", "fallos_cache", "fallos_salto"};
+
+// Una línea de caché por hilo para que los contadores no se compartan
+struct alignas(LINEA_CACHE) MedidasHilo {
+    double ocupado[NUM_FASES] = {};
+    uint64_t contadores[NUM_CONTADORES] = {};
+    int eventos[NUM_EVENTOS_HW] = {-1, -1, -1, -1};
+    uint64_t valores[NUM_EVENTOS_HW] = {};
+};
+
+// Límite de hilos con medidas propias; los contadores están siempre reservados
+// para que cualquier región paralela pueda contar sin iniciar nada. Con más
+// hilos --medidas se rechaza y los que sobran cuentan en una copia descartada.
+const int MAX_HILOS_MEDIDOS = 256;
+
+struct Instrumentacion {
+    double pared[NUM_FASES] = {};
+    uint64_t llamadas[NUM_FASES] = {};
+    bool por_hilo[NUM_FASES] = {};
+    MedidasHilo hilos[MAX_HILOS_MEDIDOS];
+    int num_hilos = 1;
+    bool hardware = false;
+
+    // Abre los contadores de hardware desde cada hilo del equipo, que OpenMP
+    // reutiliza en las regiones siguientes con el mismo número de hilos
+    void iniciar(int num_hilos) {
+        num_hilos = min(num_hilos, MAX_HILOS_MEDIDOS);
+        this->num_hilos = num_hilos;
+        bool abiertos = true;
+        #pragma omp parallel num_threads(num_hilos) reduction(&&:abiertos)
+        {
+            MedidasHilo &medidas = hilos[omp_get_thread_num()];
+            for (int e = 0; e < NUM_EVENTOS_HW; e++) {
+                perf_event_attr atributos = {};
+                atributos.type = PERF_TYPE_HARDWARE;
+                atributos.size = sizeof(atributos);
+                atributos.config = EVENTOS_HW[e];
+                atributos.exclude_kernel = 1;
+                atributos.exclude_hv = 1;
+                medidas.eventos[e] = syscall(SYS_perf_event_open, &atributos, 0, -1, -1, 0);
+                abiertos = abiertos && medidas.eventos[e] != -1;
+            }
+        }
+        hardware = abiertos;
+    }
+
+    void leer_hardware() {
+        if (!hardware) {
+            return;
+        }
+        #pragma omp parallel num_threads(num_hilos)
+        {
+            MedidasHilo &medidas = hilos[omp_get_thread_num()];
+            for (int e = 0; e < NUM_EVENTOS_HW; e++) {
+                if (read(medidas.eventos[e], &medidas.valores[e], sizeof(uint64_t)) != sizeof(uint64_t)) {
+                    medidas.valores[e] = 0;
+                }
+                close(medidas.eventos[e]);
+            }
+        }
+    }
+
+    MedidasHilo &hilo() {
+        int t = omp_get_thread_num();
+        if (t < MAX_HILOS_MEDIDOS) {
+            return hilos[t];
+        }
+        static thread_local MedidasHilo descartadas;
+        return descartadas;
+    }
+
+    bool exportar_json(const string &ruta, const char *motor, int filas, int columnas, int generaciones) {
+        leer_hardware();
+        ofstream archivo(ruta);
+        if (!archivo.is_open()) {
+            return false;
+        }
+        auto lista = [&](auto valor) {
+            archivo << "[";
+            for (int t = 0; t < num_hilos; t++) {
+                archivo << (t ? ", " : "") << valor(hilos[t]);
+            }
+            archivo << "]";
+        };
+
+        archivo << "{\n  \"motor\": \"" << motor << "\",\n  \"hilos\": " << num_hilos
+                << ",\n  \"filas\": " << filas << ",\n  \"columnas\": " << columnas
+                << ",\n  \"generaciones\": " << generaciones << ",\n  \"fases\": [\n";
+        for (int f = 0; f < NUM_FASES; f++) {
+            archivo << "    {\"nombre\": \"" << NOMBRES_FASES[f] << "\", \"llamadas\": " << llamadas[f]
+                    << ", \"segundos\": " << pared[f];
+            if (por_hilo[f]) {
+                archivo << ", \"ocupado_por_hilo\": ";
+                lista([&](const MedidasHilo &m) { return m.ocupado[f]; });
+                archivo << ", \"inactivo_por_hilo\": ";
+                lista([&](const MedidasHilo &m) { return max(0.0, pared[f] - m.ocupado[f]); });
+            }
+            archivo << "}" << (f + 1 < NUM_FASES ? "," : "") << "\n";
+        }
+
+        uint64_t totales[NUM_CONTADORES] = {};
+        for (const MedidasHilo &m : hilos) {
+            for (int c = 0; c < NUM_CONTADORES; c++) {
+                totales[c] += m.contadores[c];
+            }
+        }
+        archivo << "  ],\n  \"contadores\": {";
+        for (int c = 0; c < NUM_CONTADORES; c++) {
+            archivo << "\"" << NOMBRES_CONTADORES[c] << "\": " << totales[c] << ", ";
+        }
+        archivo << "\"conflictos\": " << totales[CONTADOR_RECLAMOS] - totales[CONTADOR_CELDAS_RECLAMADAS] << "},\n";
+
+        archivo << "  \"hardware\": ";
+        if (hardware) {
+            archivo << "{";
+            for (int e = 0; e < NUM_EVENTOS_HW; e++) {
+                archivo << (e ? ", " : "") << "\"" << NOMBRES_EVENTOS_HW[e] << "\": ";
+                lista([&](const MedidasHilo &m) { return m.valores[e]; });
+            }
+            archivo << "}\n";
+        } else {
+            archivo << "null\n";
+        }
+        archivo << "}\n";
+        return archivo.good();
+    }
+};
+
+Instrumentacion instrumentacion;
+
+inline void terminar_fase(FaseMedida fase, double inicio) {
+    instrumentacion.pared[fase] += omp_get_wtime() - inicio;
+    instrumentacion.llamadas[fase]++;
+}
+
+struct TemporizadorFase {
+    FaseMedida fase;
+    double inicio;
+    TemporizadorFase(FaseMedida f) : fase(f), inicio(omp_get_wtime()) {}
+    ~TemporizadorFase() {
+        terminar_fase(fase, inicio);
+    }
+};
+
+struct TemporizadorHilo {
+    FaseMedida fase;
+    double inicio;
+    TemporizadorHilo(FaseMedida f) : fase(f), inicio(omp_get_wtime()) {}
+    ~TemporizadorHilo() {
+        instrumentacion.hilo().ocupado[fase] += omp_get_wtime() - inicio;
+        instrumentacion.por_hilo[fase] = true;
+    }
+};
+
+#define CONCATENAR_(a, b) a##b
+#define CONCATENAR(a, b) CONCATENAR_(a, b)
+#define MEDIR_FASE(f) TemporizadorFase CONCATENAR(temporizador_, __LINE__)(f)
+#define INICIAR_FASE(f) double inicio_##f = omp_get_wtime()
+#define TERMINAR_FASE(f) terminar_fase(f, inicio_##f)
+#define MEDIR_HILO(f) TemporizadorHilo CONCATENAR(temporizador_hilo_, __LINE__)(f)
+#define CONTAR(c, n) (instrumentacion.hilo().contadores[c] += (n))
+#define SINCRONIZAR(m) (m).sincronizar()
+#else
+#define MEDIR_FASE(f)
+#define INICIAR_FASE(f)
+#define TERMINAR_FASE(f)
+#define MEDIR_HILO(f)
+#define CONTAR(c, n)
+#define SINCRONIZAR(m)
+#endif
+
+// Arena para la memoria temporal de una generación: reservar es avanzar un
+// puntero y nada se libera hasta reiniciar(). Lo que no cabe va a bloques de
+// desbordamiento; al reiniciar el bloque principal crece hasta lo usado en la
+// generación, así en régimen estable una generación no llama a malloc.
+class Arena {
+    unique_ptr<char[]> bloque;
+    size_t capacidad = 0;
+    size_t usado = 0;
+    vector<unique_ptr<char[]>> desbordes;
+    size_t desbordado = 0;
+
+public:
+    void *reservar(size_t bytes, size_t alineacion) {
+        uintptr_t base = (uintptr_t)bloque.get();
+        size_t inicio = ((base + usado + alineacion - 1) & ~(uintptr_t)(alineacion - 1)) - base;
+        if (bloque && inicio + bytes <= capacidad) {
+            usado = inicio + bytes;
+            return bloque.get() + inicio;
+        }
+        desbordes.emplace_back(new char[bytes + alineacion]);
+        desbordado += bytes + alineacion;
+        uintptr_t p = (uintptr_t)desbordes.back().get();
+        return (void *)((p + alineacion - 1) & ~(uintptr_t)(alineacion - 1));
+    }
+
+    void reiniciar() {
+        if (!desbordes.empty()) {
+            capacidad = (capacidad + desbordado) * 2;
+            bloque.reset(new char[capacidad]);
+            desbordes.clear();
+            desbordado = 0;
+        }
+        usado = 0;
+    }
+};
+
+// Asignador de contenedores sobre una arena; sin arena usa la memoria normal.
+// Liberar en la arena no hace nada, la memoria vuelve al reiniciarla.
+template <typename T>
+struct AsignadorArena {
+    using value_type = T;
+    Arena *arena = nullptr;
+
+    AsignadorArena(Arena *a = nullptr) : arena(a) {}
+    template <typename U>
+    AsignadorArena(const AsignadorArena<U> &otro) : arena(otro.arena) {}
+
+    T *allocate(size_t n) {
+        if (arena) {
+            return static_cast<T *>(arena->reservar(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t) {
+        if (!arena) {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const AsignadorArena<U> &otro) const { return arena == otro.arena; }
+    template <typename U>
+    bool operator!=(const AsignadorArena<U> &otro) const { return arena != otro.arena; }
+};
+
+// Vector de una sola generación; no debe sobrevivir al reinicio de su arena
+template <typename T>
+using VectorTemporal = vector<T, AsignadorArena<T>>;
+
+// Una arena por hilo del equipo, para que los hilos reserven sin compartir
+// puntero. Los hilos que no tengan la suya usan la memoria normal.
+struct ArenasHilos {
+    vector<Arena> arenas;
+
+    ArenasHilos() : arenas(omp_get_max_threads()) {}
+
+    Arena *de_hilo() {
+        size_t h = omp_get_thread_num();
+        return h < arenas.size() ? &arenas[h] : nullptr;
+    }
+
+    // Al final de cada generación
+    void reiniciar() {
+        for (Arena &arena : arenas) {
+            arena.reiniciar();
+        }
+    }
 };
 
+// Convierte las cuentas en desplazamientos (suma prefija exclusiva) y devuelve el total
+template <typename Vector>
+size_t suma_prefija_exclusiva(Vector &cuentas) {
+    size_t total = 0;
+    for (size_t i = 0; i < cuentas.size(); i++) {
+        size_t cuenta = cuentas[i];
+        cuentas[i] = total;
+        total += cuenta;
+    }
+    return total;
+}
+
+// Quita en paralelo los elementos marcados conservando el orden de los demás.
+// Cada hilo cuenta los que quedan en su bloque, se acumulan las cuentas y cada
+// bloque copia los suyos a partir de su desplazamiento.
+// Los compactados se escriben en el vector dado, que acaba intercambiado con
+// el original, así quien lo guarde de una llamada a otra no reserva memoria.
+template <typename T, typename Descartar>
+void compactar(vector<T> &elementos, const Descartar &descartar, vector<T> &compactados, Arena *arena = nullptr) {
+    int num_bloques = omp_get_max_threads();
+    size_t n = elementos.size();
+    VectorTemporal<size_t> por_bloque(num_bloques, 0, AsignadorArena<size_t>(arena));
+
+    #pragma omp parallel num_threads(num_bloques)
+    {
+        int b = omp_get_thread_num();
+        int bloques = omp_get_num_threads();
+        size_t inicio = n * b / bloques;
+        size_t fin = n * (b + 1) / bloques;
+
+        size_t cuenta = 0;
+        for (size_t i = inicio; i < fin; i++) {
+            cuenta += !descartar[i];
+        }
+        por_bloque[b] = cuenta;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            compactados.resize(suma_prefija_exclusiva(por_bloque));
+        }
+
+        size_t k = por_bloque[b];
+        for (size_t i = inicio; i < fin; i++) {
+            if (!descartar[i]) {
+                compactados[k++] = elementos[i];
+            }
+        }
+    }
+
+    elementos.swap(compactados);
+}
+
+template <typename T>
+void compactar(vector<T> &elementos, const vector<uint8_t> &descartar) {
+    vector<T> compactados;
+    compactar(elementos, descartar, compactados);
+}
+
 void inicializar_mundo(ifstream &archivo_entrada, Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros, Parametros &params, int &num_rocas) {
     if (params.gen_proc_conejos == 0){
         archivo_entrada >> params.gen_proc_conejos >> params.gen_proc_zorros >> params.gen_comida_zorros 
@@ -55,7 +585,7 @@ void inicializar_mundo(ifstream &archivo_entrada, Mundo &mundo, vector<Conejo> &
     
     archivo_entrada >> mundo.filas >> mundo.columnas >> params.num_objetos;
     
-    mundo.matriz.resize(mundo.filas, vector<int>(mundo.columnas, VACIO));
+    mundo.matriz.redimensionar(mundo.filas, mundo.columnas, VACIO, ROCA);
     
     for (int i = 0; i < params.num_objetos; i++) {
         string tipo_objeto;
@@ -63,11 +593,11 @@ void inicializar_mundo(ifstream &archivo_entrada, Mundo &mundo, vector<Conejo> &
         archivo_entrada >> tipo_objeto >> x >> y;
         
         if (tipo_objeto == "ROCK") {
-            mundo.matriz[x][y] = ROCA;
+            mundo.matriz(x, y) = ROCA;
             num_rocas++;
         } 
         else if (tipo_objeto == "RABBIT") {
-            mundo.matriz[x][y] = CONEJO;
+            mundo.matriz(x, y) = CONEJO;
             
             Conejo nuevo_conejo;
             nuevo_conejo.x = x;
@@ -77,7 +607,7 @@ void inicializar_mundo(ifstream &archivo_entrada, Mundo &mundo, vector<Conejo> &
             conejos.push_back(nuevo_conejo);
         } 
         else if (tipo_objeto == "FOX") {
-            mundo.matriz[x][y] = ZORRO;
+            mundo.matriz(x, y) = ZORRO;
             
             Zorro nuevo_zorro;
             nuevo_zorro.x = x;
@@ -90,93 +620,836 @@ void inicializar_mundo(ifstream &archivo_entrada, Mundo &mundo, vector<Conejo> &
     }
 }
 
-void inicializar_edad(Mundo &mundo, vector<vector<Conejo>> &conejos_nuevos, vector<vector<Zorro>> &zorros_nuevos){
-    #pragma omp parallel for collapse(2)
+// Plano de bits del mundo: un bit por celda, 64 celdas por palabra. Igual que
+// Rejilla tiene un borde de una celda: la columna j está en el bit j + 1 de su
+// fila y existen las filas -1 y filas.
+struct PlanoBits {
+    int filas = 0;
+    int columnas = 0;
+    size_t palabras = 0;  // Palabras por fila
+    vector<uint64_t> bits;
+
+    void redimensionar(int num_filas, int num_columnas) {
+        filas = num_filas;
+        columnas = num_columnas;
+        palabras = ((size_t)columnas + 2 + 63) / 64;
+        bits.assign(palabras * (filas + 2), 0);
+    }
+
+    uint64_t *fila(int x) { return &bits[(size_t)(x + 1) * palabras]; }
+    const uint64_t *fila(int x) const { return &bits[(size_t)(x + 1) * palabras]; }
+
+    bool leer(int x, int y) const {
+        return leer_en_fila(fila(x), y);
+    }
+
+    static bool leer_en_fila(const uint64_t *fila, int y) {
+        size_t b = y + 1;
+        return (fila[b >> 6] >> (b & 63)) & 1;
+    }
+
+    // Escrituras atómicas: hilos distintos pueden tocar la misma palabra
+    void encender(int x, int y) {
+        size_t b = y + 1;
+        uint64_t &palabra = fila(x)[b >> 6];
+        uint64_t bit = 1ull << (b & 63);
+        #pragma omp atomic
+        palabra |= bit;
+    }
+
+    void apagar(int x, int y) {
+        size_t b = y + 1;
+        uint64_t &palabra = fila(x)[b >> 6];
+        uint64_t bit = ~(1ull << (b & 63));
+        #pragma omp atomic
+        palabra &= bit;
+    }
+};
+
+// Claves selladas del motor de entidades: los 16 bits altos son el sello de la
+// generación, debajo van la edad + 1 y el hambre invertida en 24 bits cada una
+// (saturadas). Una clave de una generación anterior es siempre menor que
+// cualquiera de la actual, así el máximo atómico la pisa y la rejilla de
+// reclamos no hay que limpiarla cada generación.
+const uint64_t SELLO_MAXIMO = 0xFFFF;
+const uint64_t CAMPO_CLAVE_SELLADA = 0xFFFFFF;
+
+inline uint64_t clave_sellada(uint64_t sello, int edad_reproduccion, int hambre) {
+    uint64_t edad = min<uint64_t>((uint64_t)edad_reproduccion + 1, CAMPO_CLAVE_SELLADA);
+    return sello << 48 | edad << 24 | (CAMPO_CLAVE_SELLADA - min<uint64_t>(hambre, CAMPO_CLAVE_SELLADA));
+}
+
+inline uint64_t sello_de_clave(uint64_t clave) {
+    return clave >> 48;
+}
+
+inline int edad_de_clave_sellada(uint64_t clave) {
+    return (int)((clave >> 24) & CAMPO_CLAVE_SELLADA) - 1;
+}
+
+inline int hambre_de_clave_sellada(uint64_t clave) {
+    return (int)(CAMPO_CLAVE_SELLADA - (clave & CAMPO_CLAVE_SELLADA));
+}
+
+void inicializar_edad(Mundo &mundo, Rejilla<uint64_t> &conejos_nuevos, Rejilla<uint64_t> &zorros_nuevos){
+    MEDIR_FASE(FASE_INICIALIZAR_EDAD);
+    #pragma omp parallel for
     for (int i = 0; i < mundo.filas; i++) {
+        uint64_t *fila_conejos = conejos_nuevos.fila(i);
+        uint64_t *fila_zorros = zorros_nuevos.fila(i);
         for (int j = 0; j < mundo.columnas; j++) {
-            conejos_nuevos[i][j].edad_reproduccion = -1; // Marca como no válido
-            zorros_nuevos[i][j].edad_reproduccion = -1;  // Marca como no válido
+            fila_conejos[j] = 0; // Marca como no válido
+            fila_zorros[j] = 0;  // Marca como no válido
         }
     }
 }
 
-void imprimir_estado(ofstream &archivo_salida, const Mundo &mundo, vector<Zorro> &zorros, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, int num_rocas) {
-    int num_objetos = 0;
-    int ultima_generacion = 0;
-    
-    num_objetos = conejos.size() + zorros.size() + num_rocas;
+// Memoria de trabajo de mover_conejos y mover_zorros que dura toda la
+// simulación. Nada de esto se limpia ni se reserva cada generación: los
+// reclamos llevan el sello de la generación, los nacimientos se apagan al
+// recogerlos y los conejos sobrevivientes van al vector de reserva, que se
+// intercambia con el de conejos.
+struct EstadoGeneracion {
+    Rejilla<uint64_t> conejos_nuevos;
+    Rejilla<uint64_t> zorros_nuevos;
+    Rejilla<int> indice_conejos;     // Celda -> posición en el vector de conejos
+    PlanoBits nacimientos_conejos;
+    PlanoBits nacimientos_zorros;
+    vector<uint8_t> conejo_comido;
+    vector<Conejo> conejos_reserva;
+    vector<size_t> por_fila;
+    ArenasHilos arenas;              // Memoria temporal, se reinicia en cada generación
+    uint64_t sello = 0;
+
+    void preparar(const Mundo &mundo) {
+        conejos_nuevos.redimensionar(mundo.filas, mundo.columnas, 0, 0);
+        zorros_nuevos.redimensionar(mundo.filas, mundo.columnas, 0, 0);
+        indice_conejos.redimensionar(mundo.filas, mundo.columnas, -1, -1);
+        nacimientos_conejos.redimensionar(mundo.filas, mundo.columnas);
+        nacimientos_zorros.redimensionar(mundo.filas, mundo.columnas);
+        por_fila.resize(mundo.filas);
+        sello = 0;
+    }
+
+    // Solo cuando el sello da la vuelta hay que borrar los reclamos viejos
+    void nueva_generacion(Mundo &mundo) {
+        if (sello == SELLO_MAXIMO) {
+            inicializar_edad(mundo, conejos_nuevos, zorros_nuevos);
+            sello = 0;
+        }
+        sello++;
+    }
+};
+
+// Lectura rápida del formato de texto: el archivo se proyecta con mmap, los
+// números se leen con from_chars y la lista de objetos se divide en trozos que
+// se analizan en paralelo. Si el archivo no tiene la forma habitual (una
+// línea por objeto) devuelve false sin tocar nada y se usa inicializar_mundo.
+struct ObjetoTexto {
+    uint8_t tipo;  // ROCA, CONEJO, ZORRO, o VACIO si la palabra no se reconoce
+    int x;
+    int y;
+};
+
+inline bool es_espacio(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Lee un entero saltando los espacios previos, como hace operator>>
+inline bool leer_entero(const char *&p, const char *fin, int &valor) {
+    while (p < fin && es_espacio(*p)) {
+        p++;
+    }
+    if (p < fin && *p == '+') {
+        p++;
+    }
+    from_chars_result r = from_chars(p, fin, valor);
+    if (r.ec != errc()) {
+        return false;
+    }
+    p = r.ptr;
+    return true;
+}
+
+// Lee una palabra y devuelve el estado que representa
+inline bool leer_tipo(const char *&p, const char *fin, uint8_t &tipo) {
+    while (p < fin && es_espacio(*p)) {
+        p++;
+    }
+    const char *inicio = p;
+    while (p < fin && !es_espacio(*p)) {
+        p++;
+    }
+    size_t n = p - inicio;
+    if (n == 0) {
+        return false;
+    }
+    if (n == 4 && memcmp(inicio, "ROCK", 4) == 0) {
+        tipo = ROCA;
+    } else if (n == 6 && memcmp(inicio, "RABBIT", 6) == 0) {
+        tipo = CONEJO;
+    } else if (n == 3 && memcmp(inicio, "FOX", 3) == 0) {
+        tipo = ZORRO;
+    } else {
+        tipo = VACIO;
+    }
+    return true;
+}
+
+// Lee la cabecera (siete enteros) y la lista de objetos, en trozos en el orden
+// del archivo. Puede haber más objetos de los que dice la cabecera.
+bool leer_objetos_mmap(const string &ruta, int cabecera[7], vector<vector<ObjetoTexto>> &objetos) {
+    int fd = open(ruta.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size_t tamano = info.st_size;
+    if (tamano == 0) {
+        close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, tamano, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    madvise(base, tamano, MADV_SEQUENTIAL);
+    const char *inicio = static_cast<const char *>(base);
+    const char *fin = inicio + tamano;
+
+    // Cabecera
+    const char *p = inicio;
+    for (int k = 0; k < 7; k++) {
+        if (!leer_entero(p, fin, cabecera[k])) {
+            munmap(base, tamano);
+            return false;
+        }
+    }
+    int num_objetos = cabecera[6];
+
+    // Trozos de la lista de objetos, cortados en saltos de línea
+    int num_trozos = omp_get_max_threads() * 4;
+    vector<const char *> cortes(num_trozos + 1);
+    cortes[0] = p;
+    cortes[num_trozos] = fin;
+    for (int t = 1; t < num_trozos; t++) {
+        const char *c = p + (fin - p) * t / num_trozos;
+        c = max(c, cortes[t - 1]);
+        while (c < fin && *c != '\n') {
+            c++;
+        }
+        cortes[t] = c;
+    }
+
+    objetos.assign(num_trozos, vector<ObjetoTexto>());
+    vector<uint8_t> valido(num_trozos, 1);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < num_trozos; t++) {
+        const char *q = cortes[t];
+        const char *limite = cortes[t + 1];
+        objetos[t].reserve((limite - q) / 10);
+        while (true) {
+            while (q < limite && es_espacio(*q)) {
+                q++;
+            }
+            if (q >= limite) {
+                break;
+            }
+            ObjetoTexto objeto;
+            if (!leer_tipo(q, limite, objeto.tipo) || !leer_entero(q, limite, objeto.x) || !leer_entero(q, limite, objeto.y)) {
+                valido[t] = 0;  // Un objeto partido entre trozos u otro formato
+                break;
+            }
+            objetos[t].push_back(objeto);
+        }
+    }
+    munmap(base, tamano);
+
+    size_t total = 0;
+    for (int t = 0; t < num_trozos; t++) {
+        if (!valido[t]) {
+            return false;
+        }
+        total += objetos[t].size();
+    }
+    return total >= (size_t)num_objetos;
+}
+
+// Toma de la cabecera los parámetros que no se dieron en consola
+void aplicar_cabecera(const int cabecera[7], Parametros &params) {
+    if (params.gen_proc_conejos == 0) {
+        params.gen_proc_conejos = cabecera[0];
+        params.gen_proc_zorros = cabecera[1];
+        params.gen_comida_zorros = cabecera[2];
+        params.num_generaciones = cabecera[3];
+    }
+    params.num_objetos = cabecera[6];
+}
+
+bool inicializar_mundo_mmap(const string &ruta, Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros, Parametros &params, int &num_rocas) {
+    int cabecera[7];
+    vector<vector<ObjetoTexto>> objetos;
+    if (!leer_objetos_mmap(ruta, cabecera, objetos)) {
+        return false;
+    }
+    aplicar_cabecera(cabecera, params);
+    mundo.filas = cabecera[4];
+    mundo.columnas = cabecera[5];
+    mundo.matriz.redimensionar(mundo.filas, mundo.columnas, VACIO, ROCA);
+
+    // Aplicar en el orden del archivo; como inicializar_mundo, se ignora lo que
+    // sobre después de num_objetos
+    size_t restantes = params.num_objetos;
+    for (size_t t = 0; t < objetos.size() && restantes > 0; t++) {
+        for (size_t k = 0; k < objetos[t].size() && restantes > 0; k++, restantes--) {
+            const ObjetoTexto &o = objetos[t][k];
+            if (o.tipo == ROCA) {
+                mundo.matriz(o.x, o.y) = ROCA;
+                num_rocas++;
+            } else if (o.tipo == CONEJO) {
+                mundo.matriz(o.x, o.y) = CONEJO;
+                conejos.push_back({o.x, o.y, 0});
+            } else if (o.tipo == ZORRO) {
+                mundo.matriz(o.x, o.y) = ZORRO;
+                zorros.push_back({o.x, o.y, 0, 0});
+            }
+        }
+    }
+    return true;
+}
+
+// Añade "PALABRA i j\n" al búfer
+inline void formatear_objeto(string &bufer, const char *palabra, size_t largo, int i, int j) {
+    // Dos enteros de hasta 11 caracteres, dos espacios y el salto de línea
+    char numeros[32];
+    char *q = numeros;
+    *q++ = ' ';
+    q = to_chars(q, numeros + 12, i).ptr;
+    *q++ = ' ';
+    q = to_chars(q, q + 11, j).ptr;
+    *q++ = '\n';
+    bufer.append(palabra, largo);
+    bufer.append(numeros, q - numeros);
+}
 
+// Escribe el mundo en el formato de texto de entrada. Los bloques de filas se
+// formatean en paralelo en búferes grandes y se escriben en orden, una tanda de
+// bloques cada vez para acotar la memoria.
+void escribir_texto(ofstream &archivo_salida, const Mundo &mundo, const Parametros &params, int ultima_generacion, int num_objetos) {
     archivo_salida << params.gen_proc_conejos << " " << params.gen_proc_zorros << " " 
                    << params.gen_comida_zorros << " " << ultima_generacion << " " 
-                   << mundo.filas << " " << mundo.columnas << " " << num_objetos << endl;
-    
-    for (int i = 0; i < mundo.filas; i++) {
-        for (int j = 0; j < mundo.columnas; j++) {
-            if (mundo.matriz[i][j] == ROCA) {
-                archivo_salida << "ROCK " << i << " " << j << endl;
-            } 
-            else if (mundo.matriz[i][j] == CONEJO) {
-                archivo_salida << "RABBIT " << i << " " << j << endl;
-            } 
-            else if (mundo.matriz[i][j] == ZORRO) {
-                archivo_salida << "FOX " << i << " " << j << endl;
+                   << mundo.filas << " " << mundo.columnas << " " << num_objetos << "\n";
+
+    const size_t CELDAS_POR_BLOQUE = 1 << 20;
+    int filas_por_bloque = max<size_t>(1, CELDAS_POR_BLOQUE / max(1, mundo.columnas));
+    int num_bloques = (mundo.filas + filas_por_bloque - 1) / filas_por_bloque;
+    int bloques_por_tanda = omp_get_max_threads() * 2;
+    vector<string> buferes(bloques_por_tanda);
+
+    for (int primero = 0; primero < num_bloques; primero += bloques_por_tanda) {
+        int en_tanda = min(bloques_por_tanda, num_bloques - primero);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < en_tanda; b++) {
+            string &bufer = buferes[b];
+            bufer.clear();
+            int inicio = (primero + b) * filas_por_bloque;
+            int fin = min(mundo.filas, inicio + filas_por_bloque);
+            for (int i = inicio; i < fin; i++) {
+                const uint8_t *fila = mundo.matriz.fila(i);
+                for (int j = 0; j < mundo.columnas; j++) {
+                    if (fila[j] == ROCA) {
+                        formatear_objeto(bufer, "ROCK", 4, i, j);
+                    } 
+                    else if (fila[j] == CONEJO) {
+                        formatear_objeto(bufer, "RABBIT", 6, i, j);
+                    } 
+                    else if (fila[j] == ZORRO) {
+                        formatear_objeto(bufer, "FOX", 3, i, j);
+                    }
+                }
             }
         }
+
+        for (int b = 0; b < en_tanda; b++) {
+            archivo_salida.write(buferes[b].data(), buferes[b].size());
+        }
     }
+    archivo_salida.flush();
 }
 
-vector<pair<int, int>> obtener_celdas_adyacentes(int x, int y, const Mundo &mundo, int estado) {
-    vector<pair<int, int>> celdas;
+void imprimir_estado(ofstream &archivo_salida, const Mundo &mundo, vector<Zorro> &zorros, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, int num_rocas) {
+    int num_objetos = 0;
+    int ultima_generacion = 0;
+    
+    num_objetos = conejos.size() + zorros.size() + num_rocas;
+
+    escribir_texto(archivo_salida, mundo, params, ultima_generacion, num_objetos);
+}
 
-    // Verificar para mover arriba
-    if (x > 0 && mundo.matriz[x - 1][y] == estado)
-        celdas.push_back(make_pair(x - 1, y));
+// Formato binario de instantánea, versión 1. Todos los campos van en el orden
+// de bytes de la máquina que lo escribe:
+//   CabeceraInstantanea
+//   celdas:  filas * columnas bytes (VACIO, CONEJO, ZORRO o ROCA) por filas
+//   conejos: num_conejos registros Conejo
+//   zorros:  num_zorros registros Zorro
+// Cada sección empieza en un múltiplo de LINEA_CACHE para que, con el archivo
+// proyectado con mmap, se pueda leer en su sitio sin copiarla.
+const char MAGIA_INSTANTANEA[8] = {'E', 'C', 'O', 'S', 'I', 'M', 'B', '1'};
+const uint32_t VERSION_INSTANTANEA = 1;
 
-    // Verificar para mover derecha
-    if (y < mundo.columnas - 1 && mundo.matriz[x][y + 1] == estado)
-        celdas.push_back(make_pair(x, y + 1));
+struct CabeceraInstantanea {
+    char magia[8];
+    uint32_t version;
+    uint32_t tamano_cabecera;
+    int32_t filas;
+    int32_t columnas;
+    int32_t gen_proc_conejos;
+    int32_t gen_proc_zorros;
+    int32_t gen_comida_zorros;
+    int32_t num_generaciones;
+    int32_t generacion;        // Generación en la que se tomó la instantánea
+    int32_t num_rocas;
+    uint64_t num_conejos;
+    uint64_t num_zorros;
+    uint64_t desplazamiento_celdas;
+    uint64_t desplazamiento_conejos;
+    uint64_t desplazamiento_zorros;
+    uint64_t tamano_total;
+};
 
-    // Verificar para mover abajo
-    if (x < mundo.filas - 1 && mundo.matriz[x + 1][y] == estado)
-        celdas.push_back(make_pair(x + 1, y));
-        
-    // Verificar para mover izquierda
-    if (y > 0 && mundo.matriz[x][y - 1] == estado)
-        celdas.push_back(make_pair(x, y - 1));
+inline uint64_t alinear_a_linea(uint64_t desplazamiento) {
+    return (desplazamiento + LINEA_CACHE - 1) / LINEA_CACHE * LINEA_CACHE;
+}
 
-    return celdas;
+bool es_instantanea(const string &ruta) {
+    ifstream archivo(ruta, ios::binary);
+    char magia[8];
+    return archivo.read(magia, sizeof(magia)) && equal(magia, magia + 8, MAGIA_INSTANTANEA);
 }
 
+bool escribir_instantanea(const string &ruta, const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros,
+                          const Parametros &params, int generacion, int num_rocas) {
+    CabeceraInstantanea cabecera = {};
+    copy(MAGIA_INSTANTANEA, MAGIA_INSTANTANEA + 8, cabecera.magia);
+    cabecera.version = VERSION_INSTANTANEA;
+    cabecera.tamano_cabecera = sizeof(CabeceraInstantanea);
+    cabecera.filas = mundo.filas;
+    cabecera.columnas = mundo.columnas;
+    cabecera.gen_proc_conejos = params.gen_proc_conejos;
+    cabecera.gen_proc_zorros = params.gen_proc_zorros;
+    cabecera.gen_comida_zorros = params.gen_comida_zorros;
+    cabecera.num_generaciones = params.num_generaciones;
+    cabecera.generacion = generacion;
+    cabecera.num_rocas = num_rocas;
+    cabecera.num_conejos = conejos.size();
+    cabecera.num_zorros = zorros.size();
+    cabecera.desplazamiento_celdas = alinear_a_linea(sizeof(CabeceraInstantanea));
+    cabecera.desplazamiento_conejos = alinear_a_linea(cabecera.desplazamiento_celdas + (uint64_t)mundo.filas * mundo.columnas);
+    cabecera.desplazamiento_zorros = alinear_a_linea(cabecera.desplazamiento_conejos + conejos.size() * sizeof(Conejo));
+    cabecera.tamano_total = cabecera.desplazamiento_zorros + zorros.size() * sizeof(Zorro);
 
-pair<int, int> seleccionar_celda_destino(int x, int y, const vector<pair<int, int>> &celdas_posibles, int generacion_actual) {
-    if (celdas_posibles.empty()) {
-        return make_pair(-1, -1); // Indica que no hay destino válido
+    ofstream archivo(ruta, ios::binary | ios::trunc);
+    if (!archivo.is_open()) {
+        return false;
     }
-    
-    int p = celdas_posibles.size();
-    int indice = (generacion_actual + x + y) % p;
-    
-    return celdas_posibles[indice];
+    const char relleno[LINEA_CACHE] = {};
+    auto rellenar_hasta = [&](uint64_t desplazamiento) {
+        archivo.write(relleno, desplazamiento - (uint64_t)archivo.tellp());
+    };
+
+    archivo.write(reinterpret_cast<const char *>(&cabecera), sizeof(cabecera));
+    rellenar_hasta(cabecera.desplazamiento_celdas);
+    for (int i = 0; i < mundo.filas; i++) {
+        archivo.write(reinterpret_cast<const char *>(mundo.matriz.fila(i)), mundo.columnas);
+    }
+    rellenar_hasta(cabecera.desplazamiento_conejos);
+    archivo.write(reinterpret_cast<const char *>(conejos.data()), conejos.size() * sizeof(Conejo));
+    rellenar_hasta(cabecera.desplazamiento_zorros);
+    archivo.write(reinterpret_cast<const char *>(zorros.data()), zorros.size() * sizeof(Zorro));
+    return archivo.good();
 }
 
-void mover_conejos(Mundo &mundo, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, vector<vector<Conejo>> &conejos_nuevos) {
-    vector<vector<bool>> hay_conejo_nuevo(mundo.filas, vector<bool>(mundo.columnas, false));
-    
-    // Procesar cada conejo en paralelo con mejor planificación
-    #pragma omp parallel
-    {        
-        // Planificación dinámica para mejor balance de carga
-        #pragma omp for schedule(dynamic, 8)
-        for (int i = 0; i < conejos.size(); i++) {
-            int x_viejo = conejos[i].x;
-            int y_viejo = conejos[i].y;
-            
-            // Obtener celdas adyacentes
-            vector<pair<int, int>> celdas_adyacentes = obtener_celdas_adyacentes(x_viejo, y_viejo, mundo, VACIO);
-            
-            // Si hay celdas vacías alrededor, intentar moverse
+// Instantánea proyectada en memoria: los punteros apuntan directamente al
+// archivo, no se copia nada hasta que se carga en un Mundo
+struct VistaInstantanea {
+    void *base = MAP_FAILED;
+    size_t tamano = 0;
+    const CabeceraInstantanea *cabecera = nullptr;
+    const uint8_t *celdas = nullptr;
+    const Conejo *conejos = nullptr;
+    const Zorro *zorros = nullptr;
+
+    VistaInstantanea() {}
+    VistaInstantanea(const VistaInstantanea &) = delete;
+    VistaInstantanea &operator=(const VistaInstantanea &) = delete;
+
+    ~VistaInstantanea() {
+        if (base != MAP_FAILED) {
+            munmap(base, tamano);
+        }
+    }
+
+    // Devuelve un mensaje de error, o una cadena vacía si todo fue bien
+    string abrir(const string &ruta) {
+        int fd = open(ruta.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return "No se pudo abrir la instantanea: " + ruta;
+        }
+        struct stat info;
+        fstat(fd, &info);
+        tamano = info.st_size;
+        if (tamano < sizeof(CabeceraInstantanea)) {
+            close(fd);
+            return "Instantanea truncada: " + ruta;
+        }
+        base = mmap(nullptr, tamano, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            return "No se pudo proyectar la instantanea: " + ruta;
+        }
+
+        const char *bytes = static_cast<const char *>(base);
+        cabecera = reinterpret_cast<const CabeceraInstantanea *>(bytes);
+        if (!equal(cabecera->magia, cabecera->magia + 8, MAGIA_INSTANTANEA)) {
+            return "No es una instantanea: " + ruta;
+        }
+        if (cabecera->version != VERSION_INSTANTANEA || cabecera->tamano_cabecera != sizeof(CabeceraInstantanea)) {
+            return "Version de instantanea no soportada: " + ruta;
+        }
+        if (cabecera->tamano_total > tamano) {
+            return "Instantanea truncada: " + ruta;
+        }
+        // Cada sección tiene que empezar alineada tras la cabecera y caber
+        // entera en el archivo; los tamaños se comparan antes de multiplicar
+        // para que un recuento enorme no desborde
+        auto seccion_valida = [&](uint64_t desplazamiento, uint64_t cantidad, uint64_t tamano_elemento) {
+            return desplazamiento >= sizeof(CabeceraInstantanea) && desplazamiento % LINEA_CACHE == 0
+                && desplazamiento <= tamano && cantidad <= (tamano - desplazamiento) / tamano_elemento;
+        };
+        if (cabecera->filas < 1 || cabecera->columnas < 1
+            || !seccion_valida(cabecera->desplazamiento_celdas, (uint64_t)cabecera->filas * cabecera->columnas, 1)
+            || !seccion_valida(cabecera->desplazamiento_conejos, cabecera->num_conejos, sizeof(Conejo))
+            || !seccion_valida(cabecera->desplazamiento_zorros, cabecera->num_zorros, sizeof(Zorro))) {
+            return "Instantanea no valida: " + ruta;
+        }
+        celdas = reinterpret_cast<const uint8_t *>(bytes + cabecera->desplazamiento_celdas);
+        conejos = reinterpret_cast<const Conejo *>(bytes + cabecera->desplazamiento_conejos);
+        zorros = reinterpret_cast<const Zorro *>(bytes + cabecera->desplazamiento_zorros);
+        return "";
+    }
+};
+
+// Copia la instantanea al formato de trabajo. Igual que inicializar_mundo, los
+// parámetros de la instantánea solo se usan si no se ajustaron en consola.
+// Deja en generacion la generación en la que se tomó, desde la que se reanuda.
+// Devuelve un mensaje de error si alguna celda o animal no es válido (un
+// animal fuera del mundo o en una celda que no es la suya), o una cadena vacía.
+string cargar_instantanea(const VistaInstantanea &vista, Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros,
+                          Parametros &params, int &num_rocas, int &generacion) {
+    const CabeceraInstantanea &cabecera = *vista.cabecera;
+    if (params.gen_proc_conejos == 0) {
+        params.gen_proc_conejos = cabecera.gen_proc_conejos;
+        params.gen_proc_zorros = cabecera.gen_proc_zorros;
+        params.gen_comida_zorros = cabecera.gen_comida_zorros;
+        params.num_generaciones = cabecera.num_generaciones;
+    }
+    mundo.filas = cabecera.filas;
+    mundo.columnas = cabecera.columnas;
+    mundo.matriz.redimensionar(mundo.filas, mundo.columnas, VACIO, ROCA);
+
+    bool celdas_validas = true;
+    #pragma omp parallel for reduction(&&:celdas_validas)
+    for (int i = 0; i < mundo.filas; i++) {
+        const uint8_t *origen = vista.celdas + (size_t)i * mundo.columnas;
+        copy(origen, origen + mundo.columnas, mundo.matriz.fila(i));
+        for (int j = 0; j < mundo.columnas; j++) {
+            celdas_validas = celdas_validas && origen[j] <= ROCA;
+        }
+    }
+    if (!celdas_validas) {
+        return "Instantanea con celdas no validas";
+    }
+    conejos.assign(vista.conejos, vista.conejos + cabecera.num_conejos);
+    zorros.assign(vista.zorros, vista.zorros + cabecera.num_zorros);
+    auto en_su_celda = [&](const auto &animal, uint8_t estado) {
+        return animal.x >= 0 && animal.x < mundo.filas && animal.y >= 0 && animal.y < mundo.columnas
+            && animal.edad_reproduccion >= 0 && mundo.matriz(animal.x, animal.y) == estado;
+    };
+    for (const Conejo &conejo : conejos) {
+        if (!en_su_celda(conejo, CONEJO)) {
+            return "Instantanea con un conejo no valido en (" + to_string(conejo.x) + ", " + to_string(conejo.y) + ")";
+        }
+    }
+    for (const Zorro &zorro : zorros) {
+        if (!en_su_celda(zorro, ZORRO) || zorro.hambre < 0) {
+            return "Instantanea con un zorro no valido en (" + to_string(zorro.x) + ", " + to_string(zorro.y) + ")";
+        }
+    }
+    num_rocas = cabecera.num_rocas;
+    params.num_objetos = num_rocas + conejos.size() + zorros.size();
+    generacion = cabecera.generacion;
+    return "";
+}
+
+// Convierte entre el formato de texto y el binario, en el sentido que indique
+// el formato del archivo de origen
+int convertir_formato(const string &origen, const string &destino) {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    Parametros params;
+    int num_rocas = 0;
+
+    if (es_instantanea(origen)) {
+        VistaInstantanea vista;
+        string error = vista.abrir(origen);
+        if (!error.empty()) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+        int generacion;
+        error = cargar_instantanea(vista, mundo, conejos, zorros, params, num_rocas, generacion);
+        if (!error.empty()) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+        ofstream archivo_salida(destino);
+        if (!archivo_salida.is_open()) {
+            cout << "Error: No se pudo abrir el archivo de salida: " << destino << endl;
+            return 1;
+        }
+        escribir_texto(archivo_salida, mundo, params, params.num_generaciones, params.num_objetos);
+        return 0;
+    }
+
+    ifstream archivo_entrada(origen);
+    if (!archivo_entrada.is_open()) {
+        cout << "Error: No se pudo abrir el archivo de entrada: " << origen << endl;
+        return 1;
+    }
+    if (!inicializar_mundo_mmap(origen, mundo, conejos, zorros, params, num_rocas)) {
+        inicializar_mundo(archivo_entrada, mundo, conejos, zorros, params, num_rocas);
+    }
+    if (!escribir_instantanea(destino, mundo, conejos, zorros, params, 0, num_rocas)) {
+        cout << "Error: No se pudo escribir la instantanea: " << destino << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Puntos de control periódicos en el formato de instantánea. La instantánea la
+// escribe un proceso hijo creado con fork: el hijo ve una copia en escritura del
+// estado exportado y la simulación sigue sin esperar al disco. El archivo se
+// escribe aparte y se renombra al final, así siempre queda un punto de control
+// completo aunque el programa muera a medias.
+class PuntosControl {
+public:
+    void configurar(const string &ruta, int cada) {
+        this->ruta = ruta;
+        this->cada = cada;
+    }
+
+    ~PuntosControl() {
+        esperar();
+    }
+
+    bool toca(int generacion) const {
+        return !ruta.empty() && generacion % cada == 0;
+    }
+
+    void guardar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros,
+                 const Parametros &params, int generacion, int num_rocas) {
+        // Como mucho un punto de control en vuelo
+        esperar();
+        pendiente = fork();
+        if (pendiente == 0) {
+            // El hijo no usa OpenMP ni hilos, solo escribe y termina
+            string temporal = ruta + ".tmp";
+            bool ok = escribir_instantanea(temporal, mundo, conejos, zorros, params, generacion, num_rocas)
+                      && rename(temporal.c_str(), ruta.c_str()) == 0;
+            _exit(ok ? 0 : 1);
+        }
+        if (pendiente == -1) {
+            // Sin fork se escribe en el propio proceso
+            string temporal = ruta + ".tmp";
+            if (!escribir_instantanea(temporal, mundo, conejos, zorros, params, generacion, num_rocas)
+                || rename(temporal.c_str(), ruta.c_str()) != 0) {
+                cerr << "Error: No se pudo escribir el punto de control: " << ruta << endl;
+            }
+        }
+    }
+
+    void esperar() {
+        if (pendiente <= 0) {
+            return;
+        }
+        int estado;
+        waitpid(pendiente, &estado, 0);
+        if (!WIFEXITED(estado) || WEXITSTATUS(estado) != 0) {
+            cerr << "Error: No se pudo escribir el punto de control: " << ruta << endl;
+        }
+        pendiente = -1;
+    }
+
+private:
+    string ruta;
+    int cada = 1;
+    pid_t pendiente = -1;
+};
+
+// Desplazamientos de las cuatro direcciones en el orden en que se eligen:
+// arriba, derecha, abajo, izquierda
+const int DIR_FILA[4] = {-1, 0, 1, 0};
+const int DIR_COLUMNA[4] = {0, 1, 0, -1};
+
+// Bit d encendido si el vecino en la dirección d tiene el estado pedido
+inline unsigned mascara_adyacentes(const Rejilla<uint8_t> &estado, int x, int y, int valor) {
+    const uint8_t *centro = &estado(x, y);
+    size_t paso = estado.paso;
+    return (unsigned)(*(centro - paso) == valor)
+         | (unsigned)(*(centro + 1) == valor) << 1
+         | (unsigned)(*(centro + paso) == valor) << 2
+         | (unsigned)(*(centro - 1) == valor) << 3;
+}
+
+// Vecindades de los núcleos del motor de entidades: los desplazamientos en el
+// orden en que se eligen, en el sentido de las agujas del reloj desde arriba
+struct VonNeumann {
+    static const int NUM = 4;
+    static constexpr int FILA[4] = {-1, 0, 1, 0};
+    static constexpr int COLUMNA[4] = {0, 1, 0, -1};
+};
+
+struct Moore {
+    static const int NUM = 8;
+    static constexpr int FILA[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    static constexpr int COLUMNA[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+};
+
+template <typename Vecindad>
+inline unsigned mascara_vecindad(const Rejilla<uint8_t> &estado, int x, int y, int valor) {
+    const uint8_t *centro = &estado(x, y);
+    ptrdiff_t paso = estado.paso;
+    unsigned mascara = 0;
+    for (int d = 0; d < Vecindad::NUM; d++) {
+        mascara |= (unsigned)(centro[Vecindad::FILA[d] * paso + Vecindad::COLUMNA[d]] == valor) << d;
+    }
+    return mascara;
+}
+
+template <>
+inline unsigned mascara_vecindad<VonNeumann>(const Rejilla<uint8_t> &estado, int x, int y, int valor) {
+    return mascara_adyacentes(estado, x, y, valor);
+}
+
+// Contornos. En el acotado el borde de roca de la rejilla cierra el mundo y no
+// hace falta ninguna comprobación. En el toroidal el borde es una copia de las
+// filas y columnas opuestas, así las máscaras se leen igual que en el acotado,
+// y solo los destinos de los animales del borde del mundo se devuelven al otro
+// lado; los del interior no comprueban nada.
+struct Acotado {
+    static const bool ENVUELVE = false;
+    static void preparar_borde(Rejilla<uint8_t> &) {}
+};
+
+struct Toroidal {
+    static const bool ENVUELVE = true;
+
+    static void preparar_borde(Rejilla<uint8_t> &celdas) {
+        int filas = celdas.filas;
+        int columnas = celdas.columnas;
+        for (int i = 0; i < filas; i++) {
+            celdas(i, -1) = celdas(i, columnas - 1);
+            celdas(i, columnas) = celdas(i, 0);
+        }
+        for (int j = -1; j <= columnas; j++) {
+            celdas(-1, j) = celdas(filas - 1, j);
+            celdas(filas, j) = celdas(0, j);
+        }
+    }
+};
+
+template <typename Contorno>
+inline bool en_interior(int x, int y, const Mundo &mundo) {
+    return !Contorno::ENVUELVE || (x > 0 && x < mundo.filas - 1 && y > 0 && y < mundo.columnas - 1);
+}
+
+// Devuelve al mundo un destino que salió por el borde
+inline pair<int, int> envolver(pair<int, int> celda, const Mundo &mundo) {
+    int x = celda.first;
+    int y = celda.second;
+    x = x < 0 ? x + mundo.filas : x >= mundo.filas ? x - mundo.filas : x;
+    y = y < 0 ? y + mundo.columnas : y >= mundo.columnas ? y - mundo.columnas : y;
+    return make_pair(x, y);
+}
+
+// Celdas vecinas con un estado dado, sin memoria dinámica: la máscara de
+// direcciones y la lista de celdas en el mismo orden, en un arreglo fijo
+struct CeldasAdyacentes {
+    unsigned mascara = 0;
+    int cantidad = 0;
+    pair<int, int> celdas[8];
+
+    bool empty() const { return cantidad == 0; }
+};
+
+template <typename Vecindad = VonNeumann>
+CeldasAdyacentes obtener_celdas_adyacentes(int x, int y, const Mundo &mundo, int estado) {
+    CeldasAdyacentes adyacentes;
+    // El borde de la rejilla hace innecesario comprobar los límites del mundo
+    adyacentes.mascara = mascara_vecindad<Vecindad>(mundo.matriz, x, y, estado);
+
+    for (int d = 0; d < Vecindad::NUM; d++) {
+        if (adyacentes.mascara & (1u << d)) {
+            adyacentes.celdas[adyacentes.cantidad++] = make_pair(x + Vecindad::FILA[d], y + Vecindad::COLUMNA[d]);
+        }
+    }
+
+    return adyacentes;
+}
+
+
+pair<int, int> seleccionar_celda_destino(int x, int y, const CeldasAdyacentes &celdas_posibles, int generacion_actual) {
+    if (celdas_posibles.empty()) {
+        return make_pair(-1, -1); // Indica que no hay destino válido
+    }
+    
+    int p = celdas_posibles.cantidad;
+    int indice = (generacion_actual + x + y) % p;
+    
+    return celdas_posibles.celdas[indice];
+}
+
+template <typename Vecindad = VonNeumann, typename Contorno = Acotado>
+void mover_conejos(Mundo &mundo, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, EstadoGeneracion &estado) {
+    Contorno::preparar_borde(mundo.matriz);
+    Rejilla<uint64_t> &conejos_nuevos = estado.conejos_nuevos;
+    PlanoBits &hay_conejo_nuevo = estado.nacimientos_conejos;
+    uint64_t sello = estado.sello;
+    
+    // Procesar cada conejo en paralelo con mejor planificación
+    INICIAR_FASE(FASE_MOVER_CONEJOS);
+    #pragma omp parallel
+    {        
+        MEDIR_HILO(FASE_MOVER_CONEJOS);
+        // Planificación dinámica para mejor balance de carga
+        #pragma omp for schedule(dynamic, 8) nowait
+        for (int i = 0; i < conejos.size(); i++) {
+            int x_viejo = conejos[i].x;
+            int y_viejo = conejos[i].y;
+            
+            // Obtener celdas adyacentes
+            CeldasAdyacentes celdas_adyacentes = obtener_celdas_adyacentes<Vecindad>(x_viejo, y_viejo, mundo, VACIO);
+            
+            // Si hay celdas vacías alrededor, intentar moverse
             if (!celdas_adyacentes.empty()) {
                 pair<int, int> destino = seleccionar_celda_destino(x_viejo, y_viejo, celdas_adyacentes, generacion_actual);
+                if (!en_interior<Contorno>(x_viejo, y_viejo, mundo)) {
+                    destino = envolver(destino, mundo);
+                }
                 
                 if (destino.first != -1) { // Si hay un destino válido
                     int x_nuevo = destino.first;
@@ -186,11 +1459,9 @@ void mover_conejos(Mundo &mundo, vector<Conejo> &conejos, const Parametros &para
                     bool puede_reproducirse = (conejos[i].edad_reproduccion >= params.gen_proc_conejos);
                     
                     // Si puede reproducirse, dejar un nuevo conejo en la posición anterior
+                    // Cada conejo marca solo su propia celda, no hace falta sincronizar
                     if (puede_reproducirse) {
-                        #pragma omp critical
-                        {
-                            hay_conejo_nuevo[x_viejo][y_viejo] = true;
-                        }
+                        hay_conejo_nuevo.encender(x_viejo, y_viejo);
                         conejos[i].edad_reproduccion = 0;
                         
                     } else {
@@ -200,285 +1471,4755 @@ void mover_conejos(Mundo &mundo, vector<Conejo> &conejos, const Parametros &para
                     // Mover el conejo a la nueva posición
                     conejos[i].x = x_nuevo;
                     conejos[i].y = y_nuevo;
+                    CONTAR(CONTADOR_MOVIMIENTOS, 1);
                 
-                    #pragma omp critical
-                    {
-                        // Verificar si ya hay un conejo en la nueva posición
-                        if (conejos_nuevos[x_nuevo][y_nuevo].edad_reproduccion != -1) {
-                            // Comparar edades de reproducción
-                            if (conejos[i].edad_reproduccion > conejos_nuevos[x_nuevo][y_nuevo].edad_reproduccion) {
-                                // Este conejo tiene mayor edad, sobrevive
-                                conejos_nuevos[x_nuevo][y_nuevo] = conejos[i];
-                            }
-                            // Si no, el conejo existente sobrevive
-                        } else {
-                            // No hay conflicto, colocar el conejo
-                            conejos_nuevos[x_nuevo][y_nuevo] = conejos[i];
-                        }
-                    }
+                    // Si ya hay un conejo en la nueva posición sobrevive el de mayor edad
+                    reclamar_celda(conejos_nuevos(x_nuevo, y_nuevo), clave_sellada(sello, conejos[i].edad_reproduccion, 0));
                 
                 } else {
                     // No se movió, incrementar edad
                     conejos[i].edad_reproduccion++;
                     
                     // Mantener el conejo en la posición actual
-                    conejos_nuevos[x_viejo][y_viejo] = conejos[i];
+                    conejos_nuevos(x_viejo, y_viejo) = clave_sellada(sello, conejos[i].edad_reproduccion, 0);
                 }
             } else {
                 // No hay celdas vacías alrededor, incrementar edad
                 conejos[i].edad_reproduccion++;
                 
                 // Mantener el conejo en la posición actual
-                conejos_nuevos[x_viejo][y_viejo] = conejos[i];
+                conejos_nuevos(x_viejo, y_viejo) = clave_sellada(sello, conejos[i].edad_reproduccion, 0);
+            }
+        }
+    }
+    TERMINAR_FASE(FASE_MOVER_CONEJOS);
+    CONTAR(CONTADOR_RECLAMOS, conejos.size());
+
+    // Recolectar los conejos que sobrevivieron y los que nacieron en dos pasadas
+    // por filas: contar, acumular y repartir. Así el vector queda en orden de
+    // filas sin depender del número de hilos.
+    MEDIR_FASE(FASE_RECOGER_CONEJOS);
+    vector<size_t> &por_fila = estado.por_fila;
+
+    // Primera pasada: actualizar la matriz y contar los conejos de cada fila
+    #pragma omp parallel for
+    for (int i = 0; i < mundo.filas; i++) {
+        uint8_t *celdas = mundo.matriz.fila(i);
+        const uint64_t *claves = conejos_nuevos.fila(i);
+        uint64_t *nacimientos = hay_conejo_nuevo.fila(i);
+        size_t cuenta = 0;
+        for (int j = 0; j < mundo.columnas; j++) {
+            // Limpiar conejos del mundo
+            if (celdas[j] == CONEJO) {
+                celdas[j] = VACIO;
+            }
+            // Colocar a los sobrevivientes y a los nuevos conejos por reproducción
+            bool reclamada = sello_de_clave(claves[j]) == sello;
+            if (reclamada || (celdas[j] == VACIO && PlanoBits::leer_en_fila(nacimientos, j))) {
+                celdas[j] = CONEJO;
+                cuenta++;
+                CONTAR(reclamada ? CONTADOR_CELDAS_RECLAMADAS : CONTADOR_NACIMIENTOS, 1);
+            }
+        }
+        // Los nacimientos ya se usaron; la fila queda lista para la próxima generación
+        fill(nacimientos, nacimientos + hay_conejo_nuevo.palabras, 0);
+        por_fila[i] = cuenta;
+    }
+
+    conejos.resize(suma_prefija_exclusiva(por_fila));
+
+    // Segunda pasada: cada fila escribe sus conejos a partir de su desplazamiento
+    #pragma omp parallel for
+    for (int i = 0; i < mundo.filas; i++) {
+        const uint8_t *celdas = mundo.matriz.fila(i);
+        const uint64_t *claves = conejos_nuevos.fila(i);
+        int *indices = estado.indice_conejos.fila(i);
+        size_t k = por_fila[i];
+        for (int j = 0; j < mundo.columnas; j++) {
+            if (celdas[j] == CONEJO) {
+                Conejo &conejo = conejos[k];
+                conejo.x = i;
+                conejo.y = j;
+                // Sin clave de esta generación es un conejo recién nacido
+                conejo.edad_reproduccion = sello_de_clave(claves[j]) == sello ? edad_de_clave_sellada(claves[j]) : 0;
+                indices[j] = k++;
+            }
+        }
+    }
+}
+
+template <typename Vecindad = VonNeumann, typename Contorno = Acotado>
+void mover_zorros(Mundo &mundo, vector<Zorro> &zorros, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, EstadoGeneracion &estado) {
+    Contorno::preparar_borde(mundo.matriz);
+    Rejilla<uint64_t> &zorros_nuevos = estado.zorros_nuevos;
+    const Rejilla<int> &indice_conejos = estado.indice_conejos;
+    PlanoBits &hay_zorro_nuevo = estado.nacimientos_zorros;
+    uint64_t sello = estado.sello;
+    // Conejos comidos en esta generación, indexados por su posición en el vector
+    vector<uint8_t> &conejo_comido = estado.conejo_comido;
+    conejo_comido.assign(conejos.size(), 0);
+    
+    INICIAR_FASE(FASE_MOVER_ZORROS);
+    #pragma omp parallel 
+    {
+        MEDIR_HILO(FASE_MOVER_ZORROS);
+        // Mejora: usar planificación dinámica para mejor balance de carga
+        #pragma omp for schedule(dynamic, 8) nowait
+        for (int i = 0; i < zorros.size(); i++) {
+            int x_viejo = zorros[i].x;
+            int y_viejo = zorros[i].y;
+
+            // Buscar celdas adyacentes
+            CeldasAdyacentes celdas_con_conejos = obtener_celdas_adyacentes<Vecindad>(x_viejo, y_viejo, mundo, CONEJO);
+            CeldasAdyacentes celdas_adyacentes = obtener_celdas_adyacentes<Vecindad>(x_viejo, y_viejo, mundo, VACIO);
+            bool interior = en_interior<Contorno>(x_viejo, y_viejo, mundo);
+
+            bool comio = false;
+            bool murio = false;
+            int x_nuevo = x_viejo;
+            int y_nuevo = y_viejo;
+
+            // Intentar comer conejo
+            if (!celdas_con_conejos.empty()) {
+                pair<int, int> destino = seleccionar_celda_destino(x_viejo, y_viejo, celdas_con_conejos, generacion_actual);
+                if (!interior) {
+                    destino = envolver(destino, mundo);
+                }
+                x_nuevo = destino.first;
+                y_nuevo = destino.second;
+                zorros[i].hambre = 0;  // comió
+                comio = true;
+
+                // Marca al conejo comido usando el índice celda -> conejo; si dos
+                // zorros eligen el mismo conejo ambos escriben la misma marca
+                int comido = indice_conejos(x_nuevo, y_nuevo);
+                #pragma omp atomic write
+                conejo_comido[comido] = 1;
+
+            } else {
+                zorros[i].hambre++;
+                // Si no comió, revisar si muere de hambre
+                if (zorros[i].hambre >= params.gen_comida_zorros) {
+                    murio = true;
+                    CONTAR(CONTADOR_HAMBRUNAS, 1);
+                } else if (!celdas_adyacentes.empty()) {
+                    // Moverse a una celda vacía
+                    pair<int, int> destino = seleccionar_celda_destino(x_viejo, y_viejo, celdas_adyacentes, generacion_actual);
+                    if (!interior) {
+                        destino = envolver(destino, mundo);
+                    }
+                    x_nuevo = destino.first;
+                    y_nuevo = destino.second;
+                }
+            }
+
+            if (!murio) {
+                // Verificar reproducción
+                bool puede_reproducirse = (zorros[i].edad_reproduccion >= params.gen_proc_zorros);
+
+                if (puede_reproducirse && (x_nuevo != x_viejo || y_nuevo != y_viejo)){
+                    hay_zorro_nuevo.encender(x_viejo, y_viejo);
+                    zorros[i].edad_reproduccion = 0;
+                } else {
+                    zorros[i].edad_reproduccion++;
+                }
+
+                // Mover zorro
+                zorros[i].x = x_nuevo;
+                zorros[i].y = y_nuevo;
+                CONTAR(CONTADOR_MOVIMIENTOS, x_nuevo != x_viejo || y_nuevo != y_viejo);
+                CONTAR(CONTADOR_DEPREDACIONES, comio);
+                CONTAR(CONTADOR_RECLAMOS, 1);
+
+                // Sobrevive el de mayor edad y, a igual edad, el de menos hambre
+                reclamar_celda(zorros_nuevos(x_nuevo, y_nuevo), clave_sellada(sello, zorros[i].edad_reproduccion, zorros[i].hambre));
+                
+            }
+        }
+    }
+    TERMINAR_FASE(FASE_MOVER_ZORROS);
+    
+    // Eliminar los conejos comidos conservando el orden
+    INICIAR_FASE(FASE_CONEJOS_COMIDOS);
+    compactar(conejos, conejo_comido, estado.conejos_reserva, estado.arenas.de_hilo());
+    TERMINAR_FASE(FASE_CONEJOS_COMIDOS);
+    
+    MEDIR_FASE(FASE_RECOGER_ZORROS);
+    vector<size_t> &por_fila = estado.por_fila;
+
+    // Primera pasada: actualizar la matriz y contar los zorros de cada fila
+    #pragma omp parallel for
+    for (int i = 0; i < mundo.filas; i++) {
+        uint8_t *celdas = mundo.matriz.fila(i);
+        const uint64_t *claves = zorros_nuevos.fila(i);
+        uint64_t *nacimientos = hay_zorro_nuevo.fila(i);
+        size_t cuenta = 0;
+        for (int j = 0; j < mundo.columnas; j++) {
+            // Limpiar zorros del mundo
+            if (celdas[j] == ZORRO) {
+                celdas[j] = VACIO;
+            }
+            // Los sobrevivientes ocupan su celda aunque haya un conejo (se lo comen)
+            bool reclamada = sello_de_clave(claves[j]) == sello;
+            if (reclamada || (celdas[j] == VACIO && PlanoBits::leer_en_fila(nacimientos, j))) {
+                celdas[j] = ZORRO;
+                cuenta++;
+                CONTAR(reclamada ? CONTADOR_CELDAS_RECLAMADAS : CONTADOR_NACIMIENTOS, 1);
+            }
+        }
+        fill(nacimientos, nacimientos + hay_zorro_nuevo.palabras, 0);
+        por_fila[i] = cuenta;
+    }
+
+    zorros.resize(suma_prefija_exclusiva(por_fila));
+
+    // Segunda pasada: cada fila escribe sus zorros a partir de su desplazamiento
+    #pragma omp parallel for
+    for (int i = 0; i < mundo.filas; i++) {
+        const uint8_t *celdas = mundo.matriz.fila(i);
+        const uint64_t *claves = zorros_nuevos.fila(i);
+        size_t k = por_fila[i];
+        for (int j = 0; j < mundo.columnas; j++) {
+            if (celdas[j] == ZORRO) {
+                Zorro &zorro = zorros[k++];
+                zorro.x = i;
+                zorro.y = j;
+                // Sin clave de esta generación es un zorro recién nacido
+                bool reclamada = sello_de_clave(claves[j]) == sello;
+                zorro.edad_reproduccion = reclamada ? edad_de_clave_sellada(claves[j]) : 0;
+                zorro.hambre = reclamada ? hambre_de_clave_sellada(claves[j]) : 0;
+            }
+        }
+    }
+}
+
+// Interfaz común de los motores. El estado de referencia es el formato de
+// siempre (mundo, conejos y zorros); cada motor lo copia a su propia
+// representación con cargar() y lo devuelve con exportar().
+// Copia una rejilla sin su borde a un arreglo denso por filas
+inline void copiar_filas(const Rejilla<uint8_t> &celdas, uint8_t *destino) {
+    #pragma omp parallel for
+    for (int i = 0; i < celdas.filas; i++) {
+        copy(celdas.fila(i), celdas.fila(i) + celdas.columnas, destino + (size_t)i * celdas.columnas);
+    }
+}
+
+struct Motor {
+    virtual ~Motor() {}
+    virtual void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) = 0;
+    virtual void avanzar(const Parametros &params, int generacion_actual) = 0;
+    virtual void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) = 0;
+
+    // Espera a que terminen las generaciones pedidas. Solo hace falta para
+    // medir tiempos en los motores que avanzan en otros procesos; exportar
+    // ya espera por sí mismo.
+    virtual void sincronizar() {}
+
+    // Solo la matriz y las poblaciones; los motores que ya tienen la matriz
+    // pueden hacerlo sin reconstruir los vectores
+    virtual void exportar_celdas(Mundo &mundo, size_t &num_conejos, size_t &num_zorros) {
+        vector<Conejo> conejos;
+        vector<Zorro> zorros;
+        exportar(mundo, conejos, zorros);
+        num_conejos = conejos.size();
+        num_zorros = zorros.size();
+    }
+
+    // Las celdas sin borde y por filas en destino (filas * columnas bytes), para
+    // la trayectoria. Los motores que tienen la matriz la copian directamente,
+    // sin pasar por un Mundo intermedio.
+    virtual void copiar_celdas(uint8_t *destino, size_t &num_conejos, size_t &num_zorros) {
+        Mundo mundo;
+        exportar_celdas(mundo, num_conejos, num_zorros);
+        copiar_filas(mundo.matriz, destino);
+    }
+};
+
+// Una generación del motor de entidades con la vecindad y el contorno fijados
+// al compilar; la tabla elige la instancia en tiempo de ejecución
+typedef void (*NucleoEntidades)(Mundo &, vector<Conejo> &, vector<Zorro> &, const Parametros &, int, EstadoGeneracion &);
+
+template <typename Vecindad, typename Contorno>
+void avanzar_entidades(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros, const Parametros &params,
+                       int generacion_actual, EstadoGeneracion &estado) {
+    mover_conejos<Vecindad, Contorno>(mundo, conejos, params, generacion_actual, estado);
+    mover_zorros<Vecindad, Contorno>(mundo, zorros, conejos, params, generacion_actual, estado);
+}
+
+// Indexada por [vecindad][contorno]
+const NucleoEntidades NUCLEOS_ENTIDADES[2][2] = {
+    {avanzar_entidades<VonNeumann, Acotado>, avanzar_entidades<VonNeumann, Toroidal>},
+    {avanzar_entidades<Moore, Acotado>, avanzar_entidades<Moore, Toroidal>},
+};
+
+// Motor original: recorre los vectores de animales y cada uno reclama su destino
+struct MotorEntidades : Motor {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    EstadoGeneracion estado;
+
+    void cargar(const Mundo &m, const vector<Conejo> &c, const vector<Zorro> &z) override {
+        mundo = m;
+        conejos = c;
+        zorros = z;
+        estado.preparar(mundo);
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        estado.nueva_generacion(mundo);
+        NUCLEOS_ENTIDADES[params.vecindad][params.contorno](mundo, conejos, zorros, params, generacion_actual, estado);
+        estado.arenas.reiniciar();
+    }
+
+    void exportar(Mundo &m, vector<Conejo> &c, vector<Zorro> &z) override {
+        m = mundo;
+        c = conejos;
+        z = zorros;
+    }
+
+    void exportar_celdas(Mundo &m, size_t &num_conejos, size_t &num_zorros) override {
+        m = mundo;
+        num_conejos = conejos.size();
+        num_zorros = zorros.size();
+    }
+
+    void copiar_celdas(uint8_t *destino, size_t &num_conejos, size_t &num_zorros) override {
+        copiar_filas(mundo.matriz, destino);
+        num_conejos = conejos.size();
+        num_zorros = zorros.size();
+    }
+};
+
+// Códigos de la rejilla de decisiones del motor de recolección
+const uint8_t DECISION_QUIETO = 4;  // 0..3: se mueve en esa dirección
+const uint8_t DECISION_MUERE = 5;
+const uint8_t DECISION_COMIO = 8;   // Bit añadido a la dirección si se come un conejo
+
+// Indica si la decisión anotada es moverse en la dirección d
+inline bool va_hacia(uint8_t decision, int d) {
+    return (decision & ~DECISION_COMIO) == d;
+}
+
+// Misma regla que seleccionar_celda_destino, sobre una máscara no vacía
+inline uint8_t elegir_direccion(unsigned mascara, int x, int y, int generacion_actual) {
+    int indice = (generacion_actual + x + y) % __builtin_popcount(mascara);
+    for (uint8_t d = 0; d < 4; d++) {
+        if (mascara & (1u << d)) {
+            if (indice == 0) {
+                return d;
             }
+            indice--;
         }
     }
-
-    // Actualizar la lista de conejos para solo tener los que sobrevivieron y nacieron
-    conejos.clear();
-        
-    // Recolectar los conejos que sobrevivieron y crear nuevos conejos
-    #pragma omp parallel for collapse(2)
+    return DECISION_QUIETO;
+}
+
+// Motor de recolección: cada generación se calcula por celdas. Primero cada
+// animal anota en su propia celda hacia dónde va; después cada celda mira a sus
+// cuatro vecinos, decide quién acaba en ella y escribe solo su propio estado en
+// el búfer siguiente. No hay escrituras compartidas, así que no necesita
+// secciones críticas ni operaciones atómicas.
+struct MotorRecoleccion : Motor {
+    int filas = 0;
+    int columnas = 0;
+    Rejilla<uint8_t> estado[2];
+    Rejilla<int> edad[2];
+    Rejilla<int> hambre[2];
+    Rejilla<uint8_t> decision;
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        filas = mundo.filas;
+        columnas = mundo.columnas;
+        for (int b = 0; b < 2; b++) {
+            estado[b].redimensionar(filas, columnas, VACIO, ROCA);
+            edad[b].redimensionar(filas, columnas, 0, 0);
+            hambre[b].redimensionar(filas, columnas, 0, 0);
+        }
+        decision.redimensionar(filas, columnas, DECISION_QUIETO, DECISION_QUIETO);
+
+        estado[0] = mundo.matriz;
+        for (const Conejo &c : conejos) {
+            edad[0](c.x, c.y) = c.edad_reproduccion;
+        }
+        for (const Zorro &z : zorros) {
+            edad[0](z.x, z.y) = z.edad_reproduccion;
+            hambre[0](z.x, z.y) = z.hambre;
+        }
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        mover_conejos_recoleccion(params, generacion_actual);
+        mover_zorros_recoleccion(params, generacion_actual);
+    }
+
+    // Conejos: del búfer 0 al 1
+    void mover_conejos_recoleccion(const Parametros &params, int generacion_actual) {
+        const Rejilla<uint8_t> &e = estado[0];
+        const Rejilla<int> &ed = edad[0];
+
+        // Cada conejo anota su dirección
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = e.fila(i);
+            uint8_t *decisiones = decision.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] == CONEJO) {
+                    unsigned vacias = mascara_adyacentes(e, i, j, VACIO);
+                    decisiones[j] = vacias ? elegir_direccion(vacias, i, j, generacion_actual) : DECISION_QUIETO;
+                }
+            }
+        }
+
+        // Cada celda calcula su nuevo estado
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *nuevas = estado[1].fila(i);
+            int *nuevas_edades = edad[1].fila(i);
+            int *nuevas_hambres = hambre[1].fila(i);
+            for (int j = 0; j < columnas; j++) {
+                uint8_t actual = e(i, j);
+                nuevas[j] = actual;
+                nuevas_edades[j] = ed(i, j);
+                nuevas_hambres[j] = hambre[0](i, j);
+
+                if (actual == CONEJO) {
+                    if (decision(i, j) == DECISION_QUIETO) {
+                        nuevas_edades[j]++;
+                    } else if (ed(i, j) >= params.gen_proc_conejos) {
+                        // Se fue y deja una cría en su lugar
+                        nuevas_edades[j] = 0;
+                    } else {
+                        nuevas[j] = VACIO;
+                    }
+                } else if (actual == VACIO) {
+                    // Sobrevive el conejo de mayor edad de los que llegan
+                    int mejor = -1;
+                    for (int d = 0; d < 4; d++) {
+                        int x = i + DIR_FILA[d];
+                        int y = j + DIR_COLUMNA[d];
+                        if (e(x, y) == CONEJO && va_hacia(decision(x, y), (d + 2) % 4)) {
+                            int edad_vecino = ed(x, y);
+                            int edad_nueva = edad_vecino >= params.gen_proc_conejos ? 0 : edad_vecino + 1;
+                            mejor = max(mejor, edad_nueva);
+                        }
+                    }
+                    if (mejor >= 0) {
+                        nuevas[j] = CONEJO;
+                        nuevas_edades[j] = mejor;
+                    }
+                }
+            }
+        }
+    }
+
+    // Zorros: del búfer 1 al 0
+    void mover_zorros_recoleccion(const Parametros &params, int generacion_actual) {
+        const Rejilla<uint8_t> &e = estado[1];
+        const Rejilla<int> &ed = edad[1];
+        const Rejilla<int> &ha = hambre[1];
+
+        // Cada zorro anota si come, se mueve, se queda o muere
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = e.fila(i);
+            uint8_t *decisiones = decision.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] != ZORRO) {
+                    continue;
+                }
+                unsigned con_conejos = mascara_adyacentes(e, i, j, CONEJO);
+                if (con_conejos) {
+                    decisiones[j] = elegir_direccion(con_conejos, i, j, generacion_actual) | DECISION_COMIO;
+                } else if (ha(i, j) + 1 >= params.gen_comida_zorros) {
+                    decisiones[j] = DECISION_MUERE;
+                } else {
+                    unsigned vacias = mascara_adyacentes(e, i, j, VACIO);
+                    decisiones[j] = vacias ? elegir_direccion(vacias, i, j, generacion_actual) : DECISION_QUIETO;
+                }
+            }
+        }
+
+        // Cada celda calcula su nuevo estado
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *nuevas = estado[0].fila(i);
+            int *nuevas_edades = edad[0].fila(i);
+            int *nuevas_hambres = hambre[0].fila(i);
+            for (int j = 0; j < columnas; j++) {
+                uint8_t actual = e(i, j);
+                nuevas[j] = actual;
+                nuevas_edades[j] = ed(i, j);
+                nuevas_hambres[j] = ha(i, j);
+
+                if (actual == ZORRO) {
+                    uint8_t d = decision(i, j);
+                    if (d == DECISION_MUERE) {
+                        nuevas[j] = VACIO;
+                    } else if (d == DECISION_QUIETO) {
+                        nuevas_edades[j]++;
+                        nuevas_hambres[j]++;
+                    } else if (ed(i, j) >= params.gen_proc_zorros) {
+                        // Se fue y deja una cría en su lugar
+                        nuevas_edades[j] = 0;
+                        nuevas_hambres[j] = 0;
+                    } else {
+                        nuevas[j] = VACIO;
+                    }
+                } else if (actual == CONEJO || actual == VACIO) {
+                    // Sobrevive el zorro de mayor edad y, a igual edad, el de menos hambre
+                    uint64_t mejor = 0;
+                    for (int d = 0; d < 4; d++) {
+                        int x = i + DIR_FILA[d];
+                        int y = j + DIR_COLUMNA[d];
+                        if (e(x, y) == ZORRO && va_hacia(decision(x, y), (d + 2) % 4)) {
+                            int edad_vecino = ed(x, y);
+                            int edad_nueva = edad_vecino >= params.gen_proc_zorros ? 0 : edad_vecino + 1;
+                            int hambre_nueva = (decision(x, y) & DECISION_COMIO) ? 0 : ha(x, y) + 1;
+                            mejor = max(mejor, clave_prioridad(edad_nueva, hambre_nueva));
+                        }
+                    }
+                    if (mejor != 0) {
+                        nuevas[j] = ZORRO;
+                        nuevas_edades[j] = edad_de_clave(mejor);
+                        nuevas_hambres[j] = hambre_de_clave(mejor);
+                    }
+                }
+            }
+        }
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz = estado[0];
+        conejos.clear();
+        zorros.clear();
+        for (int i = 0; i < filas; i++) {
+            for (int j = 0; j < columnas; j++) {
+                if (estado[0](i, j) == CONEJO) {
+                    conejos.push_back({i, j, edad[0](i, j)});
+                } else if (estado[0](i, j) == ZORRO) {
+                    zorros.push_back({i, j, edad[0](i, j), hambre[0](i, j)});
+                }
+            }
+        }
+    }
+};
+
+// Ordena en paralelo: cada hilo ordena un bloque y después los bloques se
+// mezclan por parejas, también en paralelo. Con arenas las mezclas usan un
+// búfer de la arena de cada hilo en vez del que reserva inplace_merge.
+template <typename T, typename Comparador>
+void ordenar_en_paralelo(vector<T> &elementos, Comparador menor, ArenasHilos *arenas = nullptr) {
+    size_t n = elementos.size();
+    int num_bloques = omp_get_max_threads();
+    if (num_bloques == 1 || n < 4096) {
+        sort(elementos.begin(), elementos.end(), menor);
+        return;
+    }
+
+    VectorTemporal<size_t> limites(num_bloques + 1, 0, AsignadorArena<size_t>(arenas ? arenas->de_hilo() : nullptr));
+    for (int b = 0; b <= num_bloques; b++) {
+        limites[b] = n * b / num_bloques;
+    }
+
+    #pragma omp parallel for
+    for (int b = 0; b < num_bloques; b++) {
+        sort(elementos.begin() + limites[b], elementos.begin() + limites[b + 1], menor);
+    }
+
+    for (int ancho = 1; ancho < num_bloques; ancho *= 2) {
+        #pragma omp parallel for
+        for (int b = 0; b < num_bloques - ancho; b += 2 * ancho) {
+            int fin = min(b + 2 * ancho, num_bloques);
+            auto inicio = elementos.begin() + limites[b];
+            auto medio = elementos.begin() + limites[b + ancho];
+            auto final = elementos.begin() + limites[fin];
+            if (!arenas) {
+                inplace_merge(inicio, medio, final, menor);
+                continue;
+            }
+            VectorTemporal<T> mezcla(AsignadorArena<T>(arenas->de_hilo()));
+            mezcla.reserve(final - inicio);
+            merge(inicio, medio, medio, final, back_inserter(mezcla), menor);
+            copy(mezcla.begin(), mezcla.end(), inicio);
+        }
+    }
+}
+
+// Movimiento pendiente de resolver en los motores que trabajan con listas
+// ordenadas: la celda de destino y la clave de prioridad del animal
+struct Reclamo {
+    uint64_t celda;
+    uint64_t clave;
+};
+
+// Ordena por celda y, dentro de la misma celda, deja primero la clave mayor
+inline bool reclamo_antes(const Reclamo &a, const Reclamo &b) {
+    return a.celda < b.celda || (a.celda == b.celda && a.clave > b.clave);
+}
+
+// Deja un reclamo por celda, el ganador, en orden de filas
+void resolver_reclamos(vector<Reclamo> &reclamos, ArenasHilos *arenas = nullptr) {
+    ordenar_en_paralelo(reclamos, reclamo_antes, arenas);
+    size_t k = 0;
+    for (size_t i = 0; i < reclamos.size(); i++) {
+        if (k == 0 || reclamos[k - 1].celda != reclamos[i].celda) {
+            reclamos[k++] = reclamos[i];
+        }
+    }
+    reclamos.resize(k);
+}
+
+// Motor de planos de bits: la ocupación de cada especie es un plano de un bit
+// por celda y la edad y el hambre viven en los vectores de animales, que se
+// mantienen en orden de filas. Las consultas de vecinos se hacen sobre palabras
+// de 64 celdas con desplazamientos y los conflictos se resuelven ordenando los
+// reclamos por celda. La memoria por celda es de 3 bits más los animales.
+struct MotorBitboard : Motor {
+    int filas = 0;
+    int columnas = 0;
+    PlanoBits rocas;    // Incluye el borde, así nunca es destino
+    PlanoBits plano_conejos;
+    PlanoBits plano_zorros;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    vector<Reclamo> reclamos;
+    vector<uint64_t> crias;
+    vector<Conejo> conejos_reserva;  // Destino de compactar, se intercambia con conejos
+    ArenasHilos arenas;              // Memoria temporal de la generación
+
+    uint64_t celda_de(int x, int y) const { return (uint64_t)x * columnas + y; }
+
+    // Planos vacíos con el borde de roca: filas -1 y filas completas, y los
+    // bits fuera de las columnas
+    void iniciar(int f, int c) {
+        filas = f;
+        columnas = c;
+        rocas.redimensionar(filas, columnas);
+        plano_conejos.redimensionar(filas, columnas);
+        plano_zorros.redimensionar(filas, columnas);
+        fill(rocas.bits.begin(), rocas.bits.end(), ~0ull);
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint64_t *palabras = rocas.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                size_t b = j + 1;
+                palabras[b >> 6] &= ~(1ull << (b & 63));
+            }
+        }
+    }
+
+    // Ordena los animales ya puestos en conejos y zorros y enciende sus planos
+    void terminar_carga() {
+        ordenar_en_paralelo(conejos, por_posicion);
+        ordenar_en_paralelo(zorros, por_posicion);
+        for (const Conejo &conejo : conejos) {
+            plano_conejos.encender(conejo.x, conejo.y);
+        }
+        for (const Zorro &zorro : zorros) {
+            plano_zorros.encender(zorro.x, zorro.y);
+        }
+    }
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &c, const vector<Zorro> &z) override {
+        iniciar(mundo.filas, mundo.columnas);
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint64_t *palabras = rocas.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                size_t b = j + 1;
+                if (mundo.matriz(i, j) == ROCA) {
+                    palabras[b >> 6] |= 1ull << (b & 63);
+                }
+            }
+        }
+        conejos = c;
+        zorros = z;
+        terminar_carga();
+    }
+
+    // Carga desde la lista de objetos del texto, sin pasar por el mundo denso:
+    // la memoria es la de los planos (3 bits por celda) más los animales
+    void cargar_objetos(int f, int c, const vector<vector<ObjetoTexto>> &objetos, size_t num_objetos) {
+        iniciar(f, c);
+        conejos.clear();
+        zorros.clear();
+        size_t restantes = num_objetos;
+        for (size_t t = 0; t < objetos.size() && restantes > 0; t++) {
+            for (size_t k = 0; k < objetos[t].size() && restantes > 0; k++, restantes--) {
+                const ObjetoTexto &o = objetos[t][k];
+                if (o.tipo == ROCA) {
+                    rocas.encender(o.x, o.y);
+                } else if (o.tipo == CONEJO) {
+                    conejos.push_back({o.x, o.y, 0});
+                } else if (o.tipo == ZORRO) {
+                    zorros.push_back({o.x, o.y, 0, 0});
+                }
+            }
+        }
+        terminar_carga();
+    }
+
+    // Palabra w de la fila x con un bit encendido por celda del estado pedido
+    uint64_t palabra(int x, size_t w, int estado) const {
+        if (w >= rocas.palabras) {
+            return 0;
+        }
+        if (estado == CONEJO) {
+            return plano_conejos.fila(x)[w];
+        }
+        return ~(rocas.fila(x)[w] | plano_conejos.fila(x)[w] | plano_zorros.fila(x)[w]);
+    }
+
+    // Para las 64 celdas de la palabra w de la fila x calcula a la vez, con
+    // desplazamientos, qué vecino (arriba, derecha, abajo, izquierda) tiene el estado
+    void mascaras_palabra(int x, size_t w, int estado, uint64_t m[4]) const {
+        uint64_t centro = palabra(x, w, estado);
+        m[0] = palabra(x - 1, w, estado);
+        m[1] = (centro >> 1) | (palabra(x, w + 1, estado) << 63);
+        m[2] = palabra(x + 1, w, estado);
+        m[3] = (centro << 1) | (w > 0 ? palabra(x, w - 1, estado) >> 63 : 0);
+    }
+
+    // Máscaras de una palabra, reutilizadas mientras los animales consecutivos
+    // (que están en orden de filas) caigan en la misma palabra
+    struct CacheMascaras {
+        int x = -2;
+        size_t w = 0;
+        uint64_t m[4] = {0, 0, 0, 0};
+    };
+
+    unsigned mascara_celda(int x, int y, int estado, CacheMascaras &cache) const {
+        size_t b = y + 1;
+        if (cache.x != x || cache.w != (b >> 6)) {
+            cache.x = x;
+            cache.w = b >> 6;
+            mascaras_palabra(x, cache.w, estado, cache.m);
+        }
+        unsigned o = b & 63;
+        return (unsigned)((cache.m[0] >> o) & 1) | (unsigned)((cache.m[1] >> o) & 1) << 1
+             | (unsigned)((cache.m[2] >> o) & 1) << 2 | (unsigned)((cache.m[3] >> o) & 1) << 3;
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        mover_conejos_bits(params, generacion_actual);
+        mover_zorros_bits(params, generacion_actual);
+        arenas.reiniciar();
+    }
+
+    void mover_conejos_bits(const Parametros &params, int generacion_actual) {
+        reclamos.resize(conejos.size());
+        crias.resize(conejos.size());
+        VectorTemporal<uint8_t> tiene_cria(conejos.size(), 0, AsignadorArena<uint8_t>(arenas.de_hilo()));
+
+        #pragma omp parallel
+        {
+            CacheMascaras cache;
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < conejos.size(); i++) {
+                Conejo &conejo = conejos[i];
+                unsigned vacias = mascara_celda(conejo.x, conejo.y, VACIO, cache);
+                int x_nuevo = conejo.x;
+                int y_nuevo = conejo.y;
+                if (vacias) {
+                    int d = elegir_direccion(vacias, conejo.x, conejo.y, generacion_actual);
+                    x_nuevo += DIR_FILA[d];
+                    y_nuevo += DIR_COLUMNA[d];
+                    if (conejo.edad_reproduccion >= params.gen_proc_conejos) {
+                        tiene_cria[i] = 1;
+                        crias[i] = celda_de(conejo.x, conejo.y);
+                        conejo.edad_reproduccion = 0;
+                    } else {
+                        conejo.edad_reproduccion++;
+                    }
+                } else {
+                    conejo.edad_reproduccion++;
+                }
+                reclamos[i].celda = celda_de(x_nuevo, y_nuevo);
+                reclamos[i].clave = clave_prioridad(conejo.edad_reproduccion, 0);
+            }
+
+            // Borrar los conejos viejos del plano
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < conejos.size(); i++) {
+                plano_conejos.apagar(conejos[i].x, conejos[i].y);
+            }
+        }
+
+        // Las crías quedan en celdas que nadie más puede reclamar
+        for (size_t i = 0; i < crias.size(); i++) {
+            if (tiene_cria[i]) {
+                reclamos.push_back({crias[i], clave_prioridad(0, 0)});
+            }
+        }
+        resolver_reclamos(reclamos, &arenas);
+
+        conejos.resize(reclamos.size());
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < reclamos.size(); i++) {
+            Conejo &conejo = conejos[i];
+            conejo.x = reclamos[i].celda / columnas;
+            conejo.y = reclamos[i].celda % columnas;
+            conejo.edad_reproduccion = edad_de_clave(reclamos[i].clave);
+            plano_conejos.encender(conejo.x, conejo.y);
+        }
+    }
+
+    void mover_zorros_bits(const Parametros &params, int generacion_actual) {
+        reclamos.clear();
+        reclamos.resize(zorros.size());
+        crias.resize(zorros.size());
+        // bit 0: vive, bit 1: deja cría
+        VectorTemporal<uint8_t> estado_zorro(zorros.size(), 0, AsignadorArena<uint8_t>(arenas.de_hilo()));
+        VectorTemporal<uint8_t> conejo_comido(conejos.size(), 0, AsignadorArena<uint8_t>(arenas.de_hilo()));
+
+        #pragma omp parallel
+        {
+            CacheMascaras cache_conejos;
+            CacheMascaras cache_vacias;
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < zorros.size(); i++) {
+                Zorro &zorro = zorros[i];
+                int x_nuevo = zorro.x;
+                int y_nuevo = zorro.y;
+                unsigned con_conejos = mascara_celda(zorro.x, zorro.y, CONEJO, cache_conejos);
+
+                if (con_conejos) {
+                    int d = elegir_direccion(con_conejos, zorro.x, zorro.y, generacion_actual);
+                    x_nuevo += DIR_FILA[d];
+                    y_nuevo += DIR_COLUMNA[d];
+                    zorro.hambre = 0;
+
+                    // Los conejos están en orden de filas: se encuentra por búsqueda binaria
+                    Conejo buscado = {x_nuevo, y_nuevo, 0};
+                    size_t comido = lower_bound(conejos.begin(), conejos.end(), buscado, por_posicion) - conejos.begin();
+                    #pragma omp atomic write
+                    conejo_comido[comido] = 1;
+                } else {
+                    zorro.hambre++;
+                    if (zorro.hambre >= params.gen_comida_zorros) {
+                        continue;
+                    }
+                    unsigned vacias = mascara_celda(zorro.x, zorro.y, VACIO, cache_vacias);
+                    if (vacias) {
+                        int d = elegir_direccion(vacias, zorro.x, zorro.y, generacion_actual);
+                        x_nuevo += DIR_FILA[d];
+                        y_nuevo += DIR_COLUMNA[d];
+                    }
+                }
+
+                estado_zorro[i] = 1;
+                if (zorro.edad_reproduccion >= params.gen_proc_zorros && (x_nuevo != zorro.x || y_nuevo != zorro.y)) {
+                    estado_zorro[i] |= 2;
+                    crias[i] = celda_de(zorro.x, zorro.y);
+                    zorro.edad_reproduccion = 0;
+                } else {
+                    zorro.edad_reproduccion++;
+                }
+                reclamos[i].celda = celda_de(x_nuevo, y_nuevo);
+                reclamos[i].clave = clave_prioridad(zorro.edad_reproduccion, zorro.hambre);
+            }
+
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < zorros.size(); i++) {
+                plano_zorros.apagar(zorros[i].x, zorros[i].y);
+            }
+
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < conejos.size(); i++) {
+                if (conejo_comido[i]) {
+                    plano_conejos.apagar(conejos[i].x, conejos[i].y);
+                }
+            }
+        }
+
+        compactar(conejos, conejo_comido, conejos_reserva, arenas.de_hilo());
+
+        // Quitar los zorros muertos y añadir las crías
+        size_t k = 0;
+        for (size_t i = 0; i < zorros.size(); i++) {
+            if (estado_zorro[i] & 1) {
+                reclamos[k++] = reclamos[i];
+            }
+        }
+        reclamos.resize(k);
+        for (size_t i = 0; i < zorros.size(); i++) {
+            if (estado_zorro[i] & 2) {
+                reclamos.push_back({crias[i], clave_prioridad(0, 0)});
+            }
+        }
+        resolver_reclamos(reclamos, &arenas);
+
+        zorros.resize(reclamos.size());
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < reclamos.size(); i++) {
+            Zorro &zorro = zorros[i];
+            zorro.x = reclamos[i].celda / columnas;
+            zorro.y = reclamos[i].celda % columnas;
+            zorro.edad_reproduccion = edad_de_clave(reclamos[i].clave);
+            zorro.hambre = hambre_de_clave(reclamos[i].clave);
+            plano_zorros.encender(zorro.x, zorro.y);
+        }
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &c, vector<Zorro> &z) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz.redimensionar(filas, columnas, VACIO, ROCA);
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *celdas = mundo.matriz.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (rocas.leer(i, j)) {
+                    celdas[j] = ROCA;
+                } else if (plano_conejos.leer(i, j)) {
+                    celdas[j] = CONEJO;
+                } else if (plano_zorros.leer(i, j)) {
+                    celdas[j] = ZORRO;
+                }
+            }
+        }
+        c = conejos;
+        z = zorros;
+    }
+
+    // Las rocas se cuentan en el plano: fuera de las columnas todos los bits
+    // de la fila están encendidos
+    void poblaciones(size_t &num_conejos, size_t &num_zorros, size_t &num_rocas) const {
+        num_conejos = conejos.size();
+        num_zorros = zorros.size();
+        size_t encendidos = 0;
+        #pragma omp parallel for reduction(+:encendidos)
+        for (int i = 0; i < filas; i++) {
+            const uint64_t *palabras = rocas.fila(i);
+            for (size_t w = 0; w < rocas.palabras; w++) {
+                encendidos += __builtin_popcountll(palabras[w]);
+            }
+        }
+        num_rocas = encendidos - (size_t)filas * (rocas.palabras * 64 - columnas);
+    }
+
+    // Igual que escribir_texto, pero leyendo los planos: cada palabra se
+    // recorre solo por sus bits encendidos, así las zonas vacías casi no cuestan
+    void escribir_texto(ofstream &archivo_salida, const Parametros &params, int ultima_generacion) const {
+        size_t num_conejos, num_zorros, num_rocas;
+        poblaciones(num_conejos, num_zorros, num_rocas);
+        archivo_salida << params.gen_proc_conejos << " " << params.gen_proc_zorros << " "
+                       << params.gen_comida_zorros << " " << ultima_generacion << " "
+                       << filas << " " << columnas << " " << num_conejos + num_zorros + num_rocas << "\n";
+
+        const size_t CELDAS_POR_BLOQUE = 1 << 20;
+        int filas_por_bloque = max<size_t>(1, CELDAS_POR_BLOQUE / max(1, columnas));
+        int num_bloques = (filas + filas_por_bloque - 1) / filas_por_bloque;
+        int bloques_por_tanda = omp_get_max_threads() * 2;
+        vector<string> buferes(bloques_por_tanda);
+
+        for (int primero = 0; primero < num_bloques; primero += bloques_por_tanda) {
+            int en_tanda = min(bloques_por_tanda, num_bloques - primero);
+
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int b = 0; b < en_tanda; b++) {
+                string &bufer = buferes[b];
+                bufer.clear();
+                int inicio = (primero + b) * filas_por_bloque;
+                int fin = min(filas, inicio + filas_por_bloque);
+                for (int i = inicio; i < fin; i++) {
+                    const uint64_t *fila_rocas = rocas.fila(i);
+                    const uint64_t *fila_conejos = plano_conejos.fila(i);
+                    const uint64_t *fila_zorros = plano_zorros.fila(i);
+                    for (size_t w = 0; w < rocas.palabras; w++) {
+                        // Sin el bit del borde izquierdo ni los de después de la última columna
+                        uint64_t dentro = ~0ull;
+                        if (w == 0) {
+                            dentro &= ~1ull;
+                        }
+                        size_t fin_fila = (size_t)columnas + 1;
+                        if ((w + 1) * 64 > fin_fila) {
+                            dentro &= fin_fila > w * 64 ? (1ull << (fin_fila - w * 64)) - 1 : 0;
+                        }
+                        uint64_t ocupadas = (fila_rocas[w] | fila_conejos[w] | fila_zorros[w]) & dentro;
+                        while (ocupadas) {
+                            int o = __builtin_ctzll(ocupadas);
+                            ocupadas &= ocupadas - 1;
+                            uint64_t bit = 1ull << o;
+                            int j = (int)(w * 64 + o) - 1;
+                            if (fila_rocas[w] & bit) {
+                                formatear_objeto(bufer, "ROCK", 4, i, j);
+                            } else if (fila_conejos[w] & bit) {
+                                formatear_objeto(bufer, "RABBIT", 6, i, j);
+                            } else {
+                                formatear_objeto(bufer, "FOX", 3, i, j);
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (int b = 0; b < en_tanda; b++) {
+                archivo_salida.write(buferes[b].data(), buferes[b].size());
+            }
+        }
+        archivo_salida.flush();
+    }
+};
+
+// Tesela del motor por teselas: un rectángulo del mundo que pertenece a un
+// solo hilo. Sus rejillas tienen como borde un halo de una celda con copias de
+// las celdas de las teselas vecinas (o roca fuera del mundo), así los animales
+// del rectángulo consultan a sus vecinos sin salir de la memoria de la tesela.
+struct Tesela {
+    int f0 = 0;          // Primera fila y columna globales
+    int c0 = 0;
+    int filas = 0;
+    int columnas = 0;
+    Rejilla<uint8_t> celdas;
+    Rejilla<uint64_t> reclamos;
+    Rejilla<uint8_t> nacimientos;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    vector<vector<Reclamo>> salida;  // Movimientos hacia celdas de otras teselas, por tesela
+
+    bool contiene(int x, int y) const {
+        return x >= f0 && x < f0 + filas && y >= c0 && y < c0 + columnas;
+    }
+};
+
+// Núcleos de una fase sobre una tesela, compartidos por los motores por
+// teselas, distribuido y disperso. Solo cambia a dónde va un reclamo que cae
+// fuera de la tesela: cada motor pasa su reclamar(x, y, clave) para enrutarlo.
+void preparar_tesela(Tesela &tesela) {
+    for (int i = 0; i < tesela.filas; i++) {
+        fill(tesela.reclamos.fila(i), tesela.reclamos.fila(i) + tesela.columnas, 0);
+        fill(tesela.nacimientos.fila(i), tesela.nacimientos.fila(i) + tesela.columnas, 0);
+    }
+    for (vector<Reclamo> &buzon : tesela.salida) {
+        buzon.clear();
+    }
+}
+
+template <typename Reclamar>
+void mover_conejos_tesela(Tesela &tesela, const Parametros &params, int generacion_actual, Reclamar reclamar) {
+    preparar_tesela(tesela);
+    for (Conejo &conejo : tesela.conejos) {
+        int x = conejo.x - tesela.f0;
+        int y = conejo.y - tesela.c0;
+        unsigned vacias = mascara_adyacentes(tesela.celdas, x, y, VACIO);
+        int x_nuevo = conejo.x;
+        int y_nuevo = conejo.y;
+        if (vacias) {
+            int d = elegir_direccion(vacias, conejo.x, conejo.y, generacion_actual);
+            x_nuevo += DIR_FILA[d];
+            y_nuevo += DIR_COLUMNA[d];
+            if (conejo.edad_reproduccion >= params.gen_proc_conejos) {
+                tesela.nacimientos(x, y) = 1;
+                conejo.edad_reproduccion = 0;
+            } else {
+                conejo.edad_reproduccion++;
+            }
+        } else {
+            conejo.edad_reproduccion++;
+        }
+        reclamar(x_nuevo, y_nuevo, clave_prioridad(conejo.edad_reproduccion, 0));
+    }
+}
+
+void recoger_conejos_tesela(Tesela &tesela) {
+    tesela.conejos.clear();
+    for (int i = 0; i < tesela.filas; i++) {
+        uint8_t *celdas = tesela.celdas.fila(i);
+        const uint64_t *claves = tesela.reclamos.fila(i);
+        const uint8_t *nacimientos = tesela.nacimientos.fila(i);
+        for (int j = 0; j < tesela.columnas; j++) {
+            if (celdas[j] == CONEJO) {
+                celdas[j] = VACIO;
+            }
+            if (claves[j] != 0 || (nacimientos[j] && celdas[j] == VACIO)) {
+                celdas[j] = CONEJO;
+                int edad = claves[j] != 0 ? edad_de_clave(claves[j]) : 0;
+                tesela.conejos.push_back({tesela.f0 + i, tesela.c0 + j, edad});
+            }
+        }
+    }
+}
+
+template <typename Reclamar>
+void mover_zorros_tesela(Tesela &tesela, const Parametros &params, int generacion_actual, Reclamar reclamar) {
+    preparar_tesela(tesela);
+    for (Zorro &zorro : tesela.zorros) {
+        int x = zorro.x - tesela.f0;
+        int y = zorro.y - tesela.c0;
+        int x_nuevo = zorro.x;
+        int y_nuevo = zorro.y;
+        unsigned con_conejos = mascara_adyacentes(tesela.celdas, x, y, CONEJO);
+        if (con_conejos) {
+            int d = elegir_direccion(con_conejos, zorro.x, zorro.y, generacion_actual);
+            x_nuevo += DIR_FILA[d];
+            y_nuevo += DIR_COLUMNA[d];
+            zorro.hambre = 0;
+        } else {
+            zorro.hambre++;
+            if (zorro.hambre >= params.gen_comida_zorros) {
+                continue;
+            }
+            unsigned vacias = mascara_adyacentes(tesela.celdas, x, y, VACIO);
+            if (vacias) {
+                int d = elegir_direccion(vacias, zorro.x, zorro.y, generacion_actual);
+                x_nuevo += DIR_FILA[d];
+                y_nuevo += DIR_COLUMNA[d];
+            }
+        }
+
+        if (zorro.edad_reproduccion >= params.gen_proc_zorros && (x_nuevo != zorro.x || y_nuevo != zorro.y)) {
+            tesela.nacimientos(x, y) = 1;
+            zorro.edad_reproduccion = 0;
+        } else {
+            zorro.edad_reproduccion++;
+        }
+        reclamar(x_nuevo, y_nuevo, clave_prioridad(zorro.edad_reproduccion, zorro.hambre));
+    }
+}
+
+void recoger_zorros_tesela(Tesela &tesela) {
+    tesela.zorros.clear();
+    for (int i = 0; i < tesela.filas; i++) {
+        uint8_t *celdas = tesela.celdas.fila(i);
+        const uint64_t *claves = tesela.reclamos.fila(i);
+        const uint8_t *nacimientos = tesela.nacimientos.fila(i);
+        for (int j = 0; j < tesela.columnas; j++) {
+            if (celdas[j] == ZORRO) {
+                celdas[j] = VACIO;
+            }
+            // Un zorro que gana una celda con conejo se lo come
+            if (claves[j] != 0 || (celdas[j] == VACIO && nacimientos[j])) {
+                celdas[j] = ZORRO;
+                int edad = claves[j] != 0 ? edad_de_clave(claves[j]) : 0;
+                int hambre = claves[j] != 0 ? hambre_de_clave(claves[j]) : 0;
+                tesela.zorros.push_back({tesela.f0 + i, tesela.c0 + j, edad, hambre});
+            }
+        }
+    }
+
+    // Quitar los conejos cuya celda ahora ocupa un zorro
+    size_t vivos = 0;
+    for (size_t k = 0; k < tesela.conejos.size(); k++) {
+        const Conejo &c = tesela.conejos[k];
+        if (tesela.celdas(c.x - tesela.f0, c.y - tesela.c0) == CONEJO) {
+            tesela.conejos[vivos++] = c;
+        }
+    }
+    tesela.conejos.resize(vivos);
+}
+
+// Motor por teselas: el mundo se divide en rectángulos, uno por hilo, y cada
+// hilo trabaja casi siempre sobre la memoria de su tesela, que reserva él mismo
+// para que quede en su nodo NUMA. Protocolo de cada fase:
+//   1. Cada tesela mueve sus animales. Los destinos propios se reclaman en su
+//      rejilla de reclamos; los que caen en otra tesela se dejan en su buzón
+//      de salida para esa tesela.
+//   2. Barrera. Cada tesela lee los buzones que le mandaron las demás y los
+//      aplica a sus reclamos con la misma prioridad que los propios.
+//   3. Cada tesela recoge sobrevivientes y crías en su rectángulo.
+//   4. Barrera. Cada tesela copia en su halo los bordes de sus vecinas.
+// Ninguna escritura cruza de una tesela a otra, así que no hay atómicos.
+struct MotorTeselas : Motor {
+    int filas = 0;
+    int columnas = 0;
+    int teselas_por_fila = 1;   // Teselas en horizontal
+    int teselas_por_columna = 1;
+    vector<int> tesela_de_fila;     // Fila global -> fila de teselas
+    vector<int> tesela_de_columna;  // Columna global -> columna de teselas
+    vector<Tesela> teselas;
+
+    int duena(int x, int y) const {
+        return tesela_de_fila[x] * teselas_por_fila + tesela_de_columna[y];
+    }
+
+    void elegir_division(int num_teselas) {
+        // La división que menos borde corta entre teselas
+        long mejor = -1;
+        for (int ty = 1; ty <= num_teselas; ty++) {
+            if (num_teselas % ty != 0) {
+                continue;
+            }
+            int tx = num_teselas / ty;
+            long corte = (long)(ty - 1) * columnas + (long)(tx - 1) * filas;
+            if (mejor < 0 || corte < mejor) {
+                mejor = corte;
+                teselas_por_columna = ty;
+                teselas_por_fila = tx;
+            }
+        }
+    }
+
+    // Reparte filas y columnas entre teselas_por_columna x teselas_por_fila teselas
+    void dividir() {
+        int num_teselas = teselas_por_columna * teselas_por_fila;
+        tesela_de_fila.resize(filas);
+        tesela_de_columna.resize(columnas);
+        teselas.assign(num_teselas, Tesela());
+        for (int ty = 0; ty < teselas_por_columna; ty++) {
+            int inicio = (long)filas * ty / teselas_por_columna;
+            int fin = (long)filas * (ty + 1) / teselas_por_columna;
+            for (int x = inicio; x < fin; x++) {
+                tesela_de_fila[x] = ty;
+            }
+            for (int tx = 0; tx < teselas_por_fila; tx++) {
+                teselas[ty * teselas_por_fila + tx].f0 = inicio;
+                teselas[ty * teselas_por_fila + tx].filas = fin - inicio;
+            }
+        }
+        for (int tx = 0; tx < teselas_por_fila; tx++) {
+            int inicio = (long)columnas * tx / teselas_por_fila;
+            int fin = (long)columnas * (tx + 1) / teselas_por_fila;
+            for (int y = inicio; y < fin; y++) {
+                tesela_de_columna[y] = tx;
+            }
+            for (int ty = 0; ty < teselas_por_columna; ty++) {
+                teselas[ty * teselas_por_fila + tx].c0 = inicio;
+                teselas[ty * teselas_por_fila + tx].columnas = fin - inicio;
+            }
+        }
+    }
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        filas = mundo.filas;
+        columnas = mundo.columnas;
+        int num_teselas = omp_get_max_threads();
+        elegir_division(num_teselas);
+        dividir();
+
+        for (const Conejo &c : conejos) {
+            teselas[duena(c.x, c.y)].conejos.push_back(c);
+        }
+        for (const Zorro &z : zorros) {
+            teselas[duena(z.x, z.y)].zorros.push_back(z);
+        }
+
+        // Cada hilo reserva y llena sus propias teselas (primer acceso en su nodo)
+        #pragma omp parallel for schedule(static, 1) num_threads(num_teselas)
+        for (int t = 0; t < num_teselas; t++) {
+            Tesela &tesela = teselas[t];
+            tesela.celdas.redimensionar(tesela.filas, tesela.columnas, VACIO, ROCA);
+            tesela.reclamos.redimensionar(tesela.filas, tesela.columnas, 0, 0);
+            tesela.nacimientos.redimensionar(tesela.filas, tesela.columnas, 0, 0);
+            tesela.salida.assign(num_teselas, vector<Reclamo>());
+            for (int i = 0; i < tesela.filas; i++) {
+                for (int j = 0; j < tesela.columnas; j++) {
+                    tesela.celdas(i, j) = mundo.matriz(tesela.f0 + i, tesela.c0 + j);
+                }
+            }
+            sort(tesela.conejos.begin(), tesela.conejos.end(), por_posicion);
+            sort(tesela.zorros.begin(), tesela.zorros.end(), por_posicion);
+        }
+
+        #pragma omp parallel for schedule(static, 1) num_threads(num_teselas)
+        for (int t = 0; t < num_teselas; t++) {
+            actualizar_halo(teselas[t]);
+        }
+    }
+
+    // Copia al halo de la tesela las celdas de sus vecinas; fuera del mundo, roca
+    void actualizar_halo(Tesela &tesela) {
+        for (int i = -1; i <= tesela.filas; i++) {
+            for (int j = -1; j <= tesela.columnas; j++) {
+                if (i >= 0 && i < tesela.filas && j >= 0 && j < tesela.columnas) {
+                    j = tesela.columnas - 1;  // Saltar el interior
+                    continue;
+                }
+                int x = tesela.f0 + i;
+                int y = tesela.c0 + j;
+                if (x < 0 || x >= filas || y < 0 || y >= columnas) {
+                    tesela.celdas(i, j) = ROCA;
+                } else {
+                    const Tesela &vecina = teselas[duena(x, y)];
+                    tesela.celdas(i, j) = vecina.celdas(x - vecina.f0, y - vecina.c0);
+                }
+            }
+        }
+    }
+
+    // Reclama una celda de destino en la tesela o la envía a su dueña
+    void reclamar(Tesela &tesela, int x, int y, uint64_t clave) {
+        if (tesela.contiene(x, y)) {
+            uint64_t &celda = tesela.reclamos(x - tesela.f0, y - tesela.c0);
+            celda = max(celda, clave);
+        } else {
+            tesela.salida[duena(x, y)].push_back({(uint64_t)x * columnas + y, clave});
+        }
+    }
+
+    // Reclamar de la tesela para los núcleos compartidos
+    auto enrutar(Tesela &tesela) {
+        return [this, &tesela](int x, int y, uint64_t clave) { reclamar(tesela, x, y, clave); };
+    }
+
+    // Aplica los reclamos que las demás teselas dejaron para esta
+    void recibir(Tesela &tesela, int t) {
+        for (Tesela &origen : teselas) {
+            for (const Reclamo &r : origen.salida[t]) {
+                int x = r.celda / columnas - tesela.f0;
+                int y = r.celda % columnas - tesela.c0;
+                tesela.reclamos(x, y) = max(tesela.reclamos(x, y), r.clave);
+            }
+        }
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        int num_teselas = teselas.size();
+        #pragma omp parallel num_threads(num_teselas)
+        {
+            // Conejos
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                mover_conejos_tesela(teselas[t], params, generacion_actual, enrutar(teselas[t]));
+            }
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                recibir(teselas[t], t);
+                recoger_conejos_tesela(teselas[t]);
+            }
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                actualizar_halo(teselas[t]);
+            }
+
+            // Zorros
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                mover_zorros_tesela(teselas[t], params, generacion_actual, enrutar(teselas[t]));
+            }
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                recibir(teselas[t], t);
+                recoger_zorros_tesela(teselas[t]);
+            }
+            #pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_teselas; t++) {
+                actualizar_halo(teselas[t]);
+            }
+        }
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz.redimensionar(filas, columnas, VACIO, ROCA);
+        conejos.clear();
+        zorros.clear();
+        for (const Tesela &tesela : teselas) {
+            for (int i = 0; i < tesela.filas; i++) {
+                for (int j = 0; j < tesela.columnas; j++) {
+                    mundo.matriz(tesela.f0 + i, tesela.c0 + j) = tesela.celdas(i, j);
+                }
+            }
+            conejos.insert(conejos.end(), tesela.conejos.begin(), tesela.conejos.end());
+            zorros.insert(zorros.end(), tesela.zorros.begin(), tesela.zorros.end());
+        }
+        // Mismo orden de filas que los demás motores
+        sort(conejos.begin(), conejos.end(), por_posicion);
+        sort(zorros.begin(), zorros.end(), por_posicion);
+    }
+};
+
+// Transporte entre los procesos del motor distribuido. El proceso 0 coordina y
+// el proceso t + 1 simula la franja t. Los envíos y recepciones son bloqueantes
+// y de longitud completa; cualquier otro medio (memoria compartida, red) solo
+// tiene que implementar esta interfaz.
+struct Transporte {
+    virtual ~Transporte() {}
+    virtual void enviar(int destino, const void *datos, size_t bytes) = 0;
+    virtual void recibir(int origen, void *datos, size_t bytes) = 0;
+
+    template <typename T>
+    void enviar_vector(int destino, const vector<T> &v) {
+        size_t n = v.size();
+        enviar(destino, &n, sizeof(n));
+        enviar(destino, v.data(), n * sizeof(T));
+    }
+
+    template <typename T>
+    void recibir_vector(int origen, vector<T> &v) {
+        size_t n;
+        recibir(origen, &n, sizeof(n));
+        v.resize(n);
+        recibir(origen, v.data(), n * sizeof(T));
+    }
+};
+
+// Transporte sobre sockets Unix locales, un descriptor por proceso vecino
+struct TransporteSockets : Transporte {
+    vector<int> descriptores;  // Proceso -> descriptor, -1 si no hay conexión
+
+    ~TransporteSockets() {
+        for (int fd : descriptores) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    void enviar(int destino, const void *datos, size_t bytes) override {
+        const char *p = static_cast<const char *>(datos);
+        while (bytes > 0) {
+            ssize_t n = write(descriptores[destino], p, bytes);
+            if (n <= 0) {
+                cerr << "Error: Fallo al enviar al proceso " << destino << endl;
+                _exit(1);
+            }
+            p += n;
+            bytes -= n;
+        }
+    }
+
+    void recibir(int origen, void *datos, size_t bytes) override {
+        char *p = static_cast<char *>(datos);
+        while (bytes > 0) {
+            ssize_t n = read(descriptores[origen], p, bytes);
+            if (n <= 0) {
+                cerr << "Error: Fallo al recibir del proceso " << origen << endl;
+                _exit(1);
+            }
+            p += n;
+            bytes -= n;
+        }
+    }
+};
+
+// Órdenes del coordinador a los procesos de franja
+const int ORDEN_AVANZAR = 0;
+const int ORDEN_EXPORTAR = 1;
+const int ORDEN_TERMINAR = 2;
+const int ORDEN_SINCRONIZAR = 3;  // La franja responde cuando ha terminado las anteriores
+
+struct Orden {
+    int tipo;
+    int generacion;
+    Parametros params;
+};
+
+// Intercambia datos con una franja vecina sin bloqueo mutuo: la franja de
+// menor índice envía primero y la de mayor índice recibe primero
+template <typename Enviar, typename Recibir>
+void intercambiar(int propia, int vecina, Enviar enviar, Recibir recibir) {
+    if (propia < vecina) {
+        enviar();
+        recibir();
+    } else {
+        recibir();
+        enviar();
+    }
+}
+
+// Proceso de una franja del motor distribuido. Usa la misma lógica que el motor
+// por teselas con una sola tesela local de ancho completo: los buzones de salida
+// y las filas de halo viajan por el transporte en vez de leerse en memoria.
+// No usa OpenMP; el paralelismo viene de tener un proceso por franja.
+void ejecutar_franja(Transporte &transporte, const int datos[4]) {
+    MotorTeselas red;
+    red.filas = datos[0];
+    red.columnas = datos[1];
+    red.teselas_por_columna = datos[2];
+    red.teselas_por_fila = 1;
+    int t = datos[3];
+    int num_franjas = red.teselas_por_columna;
+    red.dividir();
+    for (Tesela &tesela : red.teselas) {
+        tesela.salida.assign(num_franjas, vector<Reclamo>());
+    }
+
+    // Franja local, con las filas de halo que manda el coordinador
+    Tesela &local = red.teselas[t];
+    local.celdas.redimensionar(local.filas, local.columnas, VACIO, ROCA);
+    local.reclamos.redimensionar(local.filas, local.columnas, 0, 0);
+    local.nacimientos.redimensionar(local.filas, local.columnas, 0, 0);
+    for (int i = -1; i <= local.filas; i++) {
+        transporte.recibir(0, local.celdas.fila(i), local.columnas);
+    }
+    transporte.recibir_vector(0, local.conejos);
+    transporte.recibir_vector(0, local.zorros);
+
+    int vecinas[2] = {t - 1, t + 1};
+
+    auto intercambiar_buzones = [&]() {
+        for (int v : vecinas) {
+            if (v < 0 || v >= num_franjas) {
+                continue;
+            }
+            intercambiar(t, v,
+                [&]() { transporte.enviar_vector(v + 1, local.salida[v]); },
+                [&]() { transporte.recibir_vector(v + 1, red.teselas[v].salida[t]); });
+        }
+    };
+
+    auto intercambiar_halo = [&]() {
+        for (int v : vecinas) {
+            if (v < 0 || v >= num_franjas) {
+                continue;
+            }
+            // A la de arriba se le manda la primera fila y se recibe su última
+            int propia = v < t ? 0 : local.filas - 1;
+            int halo = v < t ? -1 : local.filas;
+            intercambiar(t, v,
+                [&]() { transporte.enviar(v + 1, local.celdas.fila(propia), local.columnas); },
+                [&]() { transporte.recibir(v + 1, local.celdas.fila(halo), local.columnas); });
+        }
+    };
+
+    while (true) {
+        Orden orden;
+        transporte.recibir(0, &orden, sizeof(orden));
+        if (orden.tipo == ORDEN_AVANZAR) {
+            mover_conejos_tesela(local, orden.params, orden.generacion, red.enrutar(local));
+            intercambiar_buzones();
+            red.recibir(local, t);
+            recoger_conejos_tesela(local);
+            intercambiar_halo();
+
+            mover_zorros_tesela(local, orden.params, orden.generacion, red.enrutar(local));
+            intercambiar_buzones();
+            red.recibir(local, t);
+            recoger_zorros_tesela(local);
+            intercambiar_halo();
+        } else if (orden.tipo == ORDEN_EXPORTAR) {
+            for (int i = 0; i < local.filas; i++) {
+                transporte.enviar(0, local.celdas.fila(i), local.columnas);
+            }
+            transporte.enviar_vector(0, local.conejos);
+            transporte.enviar_vector(0, local.zorros);
+        } else if (orden.tipo == ORDEN_SINCRONIZAR) {
+            int listo = 1;
+            transporte.enviar(0, &listo, sizeof(listo));
+        } else {
+            return;
+        }
+    }
+}
+
+// Motor distribuido: el mundo se corta en franjas de filas, una por proceso.
+// Los procesos se lanzan con fork + exec del mismo ejecutable (el hijo de un
+// fork no puede seguir usando OpenMP) y se conectan con sockets Unix: cada
+// franja con el coordinador y con sus dos franjas vecinas.
+struct MotorDistribuido : Motor {
+    int num_procesos;
+    int filas = 0;
+    int columnas = 0;
+    vector<int> inicio_franja;
+    vector<pid_t> hijos;
+    TransporteSockets transporte;
+
+    MotorDistribuido(int procesos) : num_procesos(procesos) {}
+
+    ~MotorDistribuido() {
+        terminar();
+    }
+
+    void terminar() {
+        Orden orden = {};
+        orden.tipo = ORDEN_TERMINAR;
+        for (size_t p = 0; p < hijos.size(); p++) {
+            transporte.enviar(p + 1, &orden, sizeof(orden));
+        }
+        for (pid_t hijo : hijos) {
+            waitpid(hijo, nullptr, 0);
+        }
+        hijos.clear();
+        for (int &fd : transporte.descriptores) {
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    void lanzar(int n) {
+        // Pares de sockets: coordinador <-> franja y franja <-> franja siguiente
+        vector<int> propio(n + 1, -1);
+        vector<int> con_coordinador(n + 1, -1);
+        vector<int> arriba(n + 1, -1);
+        vector<int> abajo(n + 1, -1);
+        // Sin los sockets no hay simulación posible: se aborta como cuando
+        // falla el transporte
+        auto crear_par = [](int par[2]) {
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, par) == -1) {
+                cerr << "Error: No se pudo crear un par de sockets: " << strerror(errno) << endl;
+                exit(1);
+            }
+        };
+        for (int p = 1; p <= n; p++) {
+            int par[2];
+            crear_par(par);
+            propio[p] = par[0];
+            con_coordinador[p] = par[1];
+            if (p < n) {
+                crear_par(par);
+                abajo[p] = par[0];
+                arriba[p + 1] = par[1];
+            }
+        }
+
+        for (int p = 1; p <= n; p++) {
+            pid_t pid = fork();
+            if (pid == -1) {
+                cerr << "Error: No se pudo lanzar el proceso " << p << ": " << strerror(errno) << endl;
+                exit(1);
+            }
+            if (pid == 0) {
+                // Solo los descriptores de esta franja sobreviven al exec
+                int fds[3] = {con_coordinador[p], arriba[p], abajo[p]};
+                for (int fd : fds) {
+                    if (fd != -1) {
+                        fcntl(fd, F_SETFD, 0);
+                    }
+                }
+                string argumentos[3];
+                for (int k = 0; k < 3; k++) {
+                    argumentos[k] = to_string(fds[k]);
+                }
+                execl("/proc/self/exe", "proyectoParalelo", "--franja", argumentos[0].c_str(),
+                      argumentos[1].c_str(), argumentos[2].c_str(), (char *)nullptr);
+                _exit(127);
+            }
+            hijos.push_back(pid);
+        }
+
+        // El coordinador se queda con su extremo de cada par
+        for (int p = 1; p <= n; p++) {
+            close(con_coordinador[p]);
+            if (arriba[p] != -1) {
+                close(arriba[p]);
+            }
+            if (abajo[p] != -1) {
+                close(abajo[p]);
+            }
+        }
+        transporte.descriptores = propio;
+    }
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        terminar();
+        filas = mundo.filas;
+        columnas = mundo.columnas;
+        // Franjas de al menos una fila
+        int n = max(1, min(num_procesos, filas));
+        lanzar(n);
+
+        inicio_franja.resize(n + 1);
+        for (int t = 0; t <= n; t++) {
+            inicio_franja[t] = (long)filas * t / n;
+        }
+
+        vector<vector<Conejo>> conejos_franja(n);
+        vector<vector<Zorro>> zorros_franja(n);
+        for (const Conejo &c : conejos) {
+            int t = upper_bound(inicio_franja.begin(), inicio_franja.end(), c.x) - inicio_franja.begin() - 1;
+            conejos_franja[t].push_back(c);
+        }
+        for (const Zorro &z : zorros) {
+            int t = upper_bound(inicio_franja.begin(), inicio_franja.end(), z.x) - inicio_franja.begin() - 1;
+            zorros_franja[t].push_back(z);
+        }
+
+        for (int t = 0; t < n; t++) {
+            int datos[4] = {filas, columnas, n, t};
+            transporte.enviar(t + 1, datos, sizeof(datos));
+            // La franja con una fila de halo por arriba y otra por abajo
+            for (int i = inicio_franja[t] - 1; i <= inicio_franja[t + 1]; i++) {
+                transporte.enviar(t + 1, mundo.matriz.fila(i), columnas);
+            }
+            sort(conejos_franja[t].begin(), conejos_franja[t].end(), por_posicion);
+            sort(zorros_franja[t].begin(), zorros_franja[t].end(), por_posicion);
+            transporte.enviar_vector(t + 1, conejos_franja[t]);
+            transporte.enviar_vector(t + 1, zorros_franja[t]);
+        }
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        Orden orden = {};
+        orden.tipo = ORDEN_AVANZAR;
+        orden.generacion = generacion_actual;
+        orden.params = params;
+        for (size_t p = 0; p < hijos.size(); p++) {
+            transporte.enviar(p + 1, &orden, sizeof(orden));
+        }
+    }
+
+    // avanzar solo manda la orden; aquí se espera la respuesta de cada franja
+    void sincronizar() override {
+        Orden orden = {};
+        orden.tipo = ORDEN_SINCRONIZAR;
+        for (size_t p = 0; p < hijos.size(); p++) {
+            transporte.enviar(p + 1, &orden, sizeof(orden));
+        }
+        for (size_t p = 0; p < hijos.size(); p++) {
+            int listo;
+            transporte.recibir(p + 1, &listo, sizeof(listo));
+        }
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        Orden orden = {};
+        orden.tipo = ORDEN_EXPORTAR;
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz.redimensionar(filas, columnas, VACIO, ROCA);
+        conejos.clear();
+        zorros.clear();
+        // Las franjas están en orden de filas, así que basta con concatenarlas
+        for (size_t p = 0; p < hijos.size(); p++) {
+            transporte.enviar(p + 1, &orden, sizeof(orden));
+            for (int i = inicio_franja[p]; i < inicio_franja[p + 1]; i++) {
+                transporte.recibir(p + 1, mundo.matriz.fila(i), columnas);
+            }
+            vector<Conejo> c;
+            vector<Zorro> z;
+            transporte.recibir_vector(p + 1, c);
+            transporte.recibir_vector(p + 1, z);
+            conejos.insert(conejos.end(), c.begin(), c.end());
+            zorros.insert(zorros.end(), z.begin(), z.end());
+        }
+    }
+};
+
+// Punto de entrada de un proceso de franja: proyectoParalelo --franja fd_coordinador fd_arriba fd_abajo
+int main_franja(char* argv[]) {
+    TransporteSockets transporte;
+    int coordinador = atoi(argv[2]);
+    int arriba = atoi(argv[3]);
+    int abajo = atoi(argv[4]);
+    // Los procesos se numeran 0 (coordinador) y t + 1 (franja t); la franja
+    // conoce su índice al recibir la cabecera, así que primero solo se registra
+    // el coordinador
+    transporte.descriptores.assign(1, coordinador);
+    int datos[4];
+    transporte.recibir(0, datos, sizeof(datos));
+    int t = datos[3];
+    transporte.descriptores.assign(datos[2] + 1, -1);
+    transporte.descriptores[0] = coordinador;
+    if (t > 0) {
+        transporte.descriptores[t] = arriba;
+    }
+    if (t + 1 < datos[2]) {
+        transporte.descriptores[t + 2] = abajo;
+    }
+    ejecutar_franja(transporte, datos);
+    return 0;
+}
+
+// Trozo del motor disperso: una tesela de LADO_TROZO x LADO_TROZO celdas que
+// solo existe mientras tiene animales o rocas. Los buzones de salida van por
+// dirección, porque un movimiento solo puede caer en una de las cuatro vecinas.
+const int LADO_TROZO = 32;
+
+struct Trozo : Tesela {
+    int ti = 0;               // Posición en la rejilla de trozos
+    int tj = 0;
+    int vecinas[4] = {-1, -1, -1, -1};  // Trozo vecino en cada dirección, -1 si no existe
+    int num_rocas = 0;
+};
+
+inline int direccion_opuesta(int d) {
+    return (d + 2) % 4;
+}
+
+// Motor disperso para mundos enormes y casi vacíos. El mundo se guarda en trozos
+// que se crean cuando un animal puede entrar en ellos y se liberan cuando se
+// quedan vacíos, así la memoria crece con la población y las rocas, no con el
+// área. Cada fase sigue el protocolo del motor por teselas (mover, recibir los
+// reclamos de las vecinas, recoger, actualizar el halo) sobre los trozos vivos;
+// las celdas de un trozo que no existe están vacías.
+struct MotorDisperso : Motor {
+    int filas = 0;
+    int columnas = 0;
+    int trozos_por_fila = 0;
+    int trozos_por_columna = 0;
+    vector<unique_ptr<Trozo>> trozos;   // Por hueco; nullptr si el hueco está libre
+    vector<int> huecos_libres;
+    vector<int> vivos;                  // Huecos ocupados
+    unordered_map<uint64_t, int> indice; // (ti, tj) -> hueco
+    ArenasHilos arenas;                  // Memoria temporal de la generación
+
+    uint64_t clave_trozo(int ti, int tj) const {
+        return (uint64_t)ti * trozos_por_fila + tj;
+    }
+
+    bool dentro(int ti, int tj) const {
+        return ti >= 0 && tj >= 0 && ti < trozos_por_columna && tj < trozos_por_fila;
+    }
+
+    void iniciar(int f, int c) {
+        filas = f;
+        columnas = c;
+        trozos_por_columna = (filas + LADO_TROZO - 1) / LADO_TROZO;
+        trozos_por_fila = (columnas + LADO_TROZO - 1) / LADO_TROZO;
+        trozos.clear();
+        huecos_libres.clear();
+        vivos.clear();
+        indice.clear();
+    }
+
+    // Devuelve el hueco del trozo, creándolo vacío si no existe
+    int trozo_en(int ti, int tj) {
+        auto encontrado = indice.find(clave_trozo(ti, tj));
+        if (encontrado != indice.end()) {
+            return encontrado->second;
+        }
+        int hueco;
+        if (!huecos_libres.empty()) {
+            hueco = huecos_libres.back();
+            huecos_libres.pop_back();
+        } else {
+            hueco = trozos.size();
+            trozos.emplace_back();
+        }
+        trozos[hueco].reset(new Trozo());
+        Trozo &trozo = *trozos[hueco];
+        trozo.ti = ti;
+        trozo.tj = tj;
+        trozo.f0 = ti * LADO_TROZO;
+        trozo.c0 = tj * LADO_TROZO;
+        trozo.filas = min(LADO_TROZO, filas - trozo.f0);
+        trozo.columnas = min(LADO_TROZO, columnas - trozo.c0);
+        trozo.celdas.redimensionar(trozo.filas, trozo.columnas, VACIO, ROCA);
+        trozo.reclamos.redimensionar(trozo.filas, trozo.columnas, 0, 0);
+        trozo.nacimientos.redimensionar(trozo.filas, trozo.columnas, 0, 0);
+        trozo.salida.assign(4, vector<Reclamo>());
+        indice[clave_trozo(ti, tj)] = hueco;
+        vivos.push_back(hueco);
+
+        for (int d = 0; d < 4; d++) {
+            int vi = ti + DIR_FILA[d];
+            int vj = tj + DIR_COLUMNA[d];
+            if (!dentro(vi, vj)) {
+                continue;
+            }
+            auto vecina = indice.find(clave_trozo(vi, vj));
+            if (vecina != indice.end()) {
+                trozo.vecinas[d] = vecina->second;
+                trozos[vecina->second]->vecinas[direccion_opuesta(d)] = hueco;
+            }
+        }
+        return hueco;
+    }
+
+    Trozo &trozo_de_celda(int x, int y) {
+        return *trozos[trozo_en(x / LADO_TROZO, y / LADO_TROZO)];
+    }
+
+    // Carga secuencial de un objeto, en el orden del archivo como inicializar_mundo
+    void colocar(uint8_t tipo, int x, int y, int edad, int hambre) {
+        Trozo &trozo = trozo_de_celda(x, y);
+        trozo.celdas(x - trozo.f0, y - trozo.c0) = tipo;
+        if (tipo == ROCA) {
+            trozo.num_rocas++;
+        } else if (tipo == CONEJO) {
+            trozo.conejos.push_back({x, y, edad});
+        } else if (tipo == ZORRO) {
+            trozo.zorros.push_back({x, y, edad, hambre});
+        }
+    }
+
+    // Ordena los animales de cada trozo por filas y calcula todos los halos
+    void terminar_carga() {
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (size_t k = 0; k < vivos.size(); k++) {
+            Trozo &trozo = *trozos[vivos[k]];
+            sort(trozo.conejos.begin(), trozo.conejos.end(), por_posicion);
+            sort(trozo.zorros.begin(), trozo.zorros.end(), por_posicion);
+        }
+        actualizar_halos();
+    }
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        iniciar(mundo.filas, mundo.columnas);
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *fila = mundo.matriz.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (fila[j] == ROCA) {
+                    colocar(ROCA, i, j, 0, 0);
+                }
+            }
+        }
+        for (const Conejo &c : conejos) {
+            colocar(CONEJO, c.x, c.y, c.edad_reproduccion, 0);
+        }
+        for (const Zorro &z : zorros) {
+            colocar(ZORRO, z.x, z.y, z.edad_reproduccion, z.hambre);
+        }
+        terminar_carga();
+    }
+
+    // Carga directa de la lista de objetos del formato de texto, sin matriz densa
+    void cargar_objetos(int f, int c, const vector<vector<ObjetoTexto>> &objetos, size_t num_objetos) {
+        iniciar(f, c);
+        size_t restantes = num_objetos;
+        for (size_t t = 0; t < objetos.size() && restantes > 0; t++) {
+            for (size_t k = 0; k < objetos[t].size() && restantes > 0; k++, restantes--) {
+                const ObjetoTexto &o = objetos[t][k];
+                if (o.tipo != VACIO) {
+                    colocar(o.tipo, o.x, o.y, 0, 0);
+                }
+            }
+        }
+        terminar_carga();
+    }
+
+    // Copia en el halo los bordes de las vecinas; sin vecina la celda está
+    // vacía, salvo fuera del mundo, donde el borde de la rejilla ya es roca
+    void actualizar_halo(Trozo &trozo) {
+        const Trozo *arriba = trozo.vecinas[0] >= 0 ? trozos[trozo.vecinas[0]].get() : nullptr;
+        const Trozo *derecha = trozo.vecinas[1] >= 0 ? trozos[trozo.vecinas[1]].get() : nullptr;
+        const Trozo *abajo = trozo.vecinas[2] >= 0 ? trozos[trozo.vecinas[2]].get() : nullptr;
+        const Trozo *izquierda = trozo.vecinas[3] >= 0 ? trozos[trozo.vecinas[3]].get() : nullptr;
+        bool hay_arriba = trozo.f0 > 0;
+        bool hay_abajo = trozo.f0 + trozo.filas < filas;
+        bool hay_izquierda = trozo.c0 > 0;
+        bool hay_derecha = trozo.c0 + trozo.columnas < columnas;
+        for (int j = 0; j < trozo.columnas; j++) {
+            trozo.celdas(-1, j) = arriba ? arriba->celdas(arriba->filas - 1, j) : (hay_arriba ? VACIO : ROCA);
+            trozo.celdas(trozo.filas, j) = abajo ? abajo->celdas(0, j) : (hay_abajo ? VACIO : ROCA);
+        }
+        for (int i = 0; i < trozo.filas; i++) {
+            trozo.celdas(i, -1) = izquierda ? izquierda->celdas(i, izquierda->columnas - 1) : (hay_izquierda ? VACIO : ROCA);
+            trozo.celdas(i, trozo.columnas) = derecha ? derecha->celdas(i, 0) : (hay_derecha ? VACIO : ROCA);
+        }
+    }
+
+    void actualizar_halos() {
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (size_t k = 0; k < vivos.size(); k++) {
+            actualizar_halo(*trozos[vivos[k]]);
+        }
+    }
+
+    // Antes de mover, crea las vecinas que no existen pero en las que puede
+    // entrar un animal de la lista dada, que está en el borde que da a ellas
+    template <typename Animal>
+    void asegurar_vecinas(vector<Animal> Tesela::*animales) {
+        VectorTemporal<int> nuevos(AsignadorArena<int>(arenas.de_hilo()));
+        size_t num_vivos = vivos.size();
+        for (size_t k = 0; k < num_vivos; k++) {
+            int hueco = vivos[k];
+            int ti = trozos[hueco]->ti;
+            int tj = trozos[hueco]->tj;
+            bool hace_falta[4] = {false, false, false, false};
+            {
+                const Trozo &trozo = *trozos[hueco];
+                for (const Animal &a : trozo.*animales) {
+                    hace_falta[0] |= a.x == trozo.f0;
+                    hace_falta[1] |= a.y == trozo.c0 + trozo.columnas - 1;
+                    hace_falta[2] |= a.x == trozo.f0 + trozo.filas - 1;
+                    hace_falta[3] |= a.y == trozo.c0;
+                }
+            }
+            for (int d = 0; d < 4; d++) {
+                int vi = ti + DIR_FILA[d];
+                int vj = tj + DIR_COLUMNA[d];
+                // trozo_en puede mover el vector de huecos, se vuelve a buscar cada vez
+                if (hace_falta[d] && trozos[hueco]->vecinas[d] == -1 && dentro(vi, vj)) {
+                    nuevos.push_back(trozo_en(vi, vj));
+                }
+            }
+        }
+        // Los trozos nuevos están vacíos: sus vecinas ya los veían así
+        for (int hueco : nuevos) {
+            actualizar_halo(*trozos[hueco]);
+        }
+    }
+
+    // Libera los trozos sin animales ni rocas. Estaban vacíos, así que el halo
+    // de sus vecinas sigue siendo correcto.
+    void liberar_vacios() {
+        size_t quedan = 0;
+        for (size_t k = 0; k < vivos.size(); k++) {
+            int hueco = vivos[k];
+            Trozo &trozo = *trozos[hueco];
+            if (!trozo.conejos.empty() || !trozo.zorros.empty() || trozo.num_rocas > 0) {
+                vivos[quedan++] = hueco;
+                continue;
+            }
+            for (int d = 0; d < 4; d++) {
+                if (trozo.vecinas[d] >= 0) {
+                    trozos[trozo.vecinas[d]]->vecinas[direccion_opuesta(d)] = -1;
+                }
+            }
+            indice.erase(clave_trozo(trozo.ti, trozo.tj));
+            trozos[hueco].reset();
+            huecos_libres.push_back(hueco);
+        }
+        vivos.resize(quedan);
+    }
+
+    void reclamar(Trozo &trozo, int x, int y, uint64_t clave) {
+        if (trozo.contiene(x, y)) {
+            uint64_t &celda = trozo.reclamos(x - trozo.f0, y - trozo.c0);
+            celda = max(celda, clave);
+            return;
+        }
+        int d = x < trozo.f0 ? 0 : y >= trozo.c0 + trozo.columnas ? 1 : x >= trozo.f0 + trozo.filas ? 2 : 3;
+        trozo.salida[d].push_back({(uint64_t)x * columnas + y, clave});
+    }
+
+    auto enrutar(Trozo &trozo) {
+        return [this, &trozo](int x, int y, uint64_t clave) { reclamar(trozo, x, y, clave); };
+    }
+
+    void recibir(Trozo &trozo) {
+        for (int d = 0; d < 4; d++) {
+            if (trozo.vecinas[d] < 0) {
+                continue;
+            }
+            for (const Reclamo &r : trozos[trozo.vecinas[d]]->salida[direccion_opuesta(d)]) {
+                int x = r.celda / columnas - trozo.f0;
+                int y = r.celda % columnas - trozo.c0;
+                trozo.reclamos(x, y) = max(trozo.reclamos(x, y), r.clave);
+            }
+        }
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        // Conejos
+        asegurar_vecinas(&Tesela::conejos);
+        int n = vivos.size();
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                Trozo &trozo = *trozos[vivos[k]];
+                mover_conejos_tesela(trozo, params, generacion_actual, enrutar(trozo));
+            }
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                recibir(*trozos[vivos[k]]);
+                recoger_conejos_tesela(*trozos[vivos[k]]);
+            }
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                actualizar_halo(*trozos[vivos[k]]);
+            }
+        }
+
+        // Zorros
+        asegurar_vecinas(&Tesela::zorros);
+        n = vivos.size();
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                Trozo &trozo = *trozos[vivos[k]];
+                mover_zorros_tesela(trozo, params, generacion_actual, enrutar(trozo));
+            }
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                recibir(*trozos[vivos[k]]);
+                recoger_zorros_tesela(*trozos[vivos[k]]);
+            }
+            #pragma omp for schedule(dynamic, 4)
+            for (int k = 0; k < n; k++) {
+                actualizar_halo(*trozos[vivos[k]]);
+            }
+        }
+        liberar_vacios();
+        arenas.reiniciar();
+    }
+
+    void poblaciones(size_t &num_conejos, size_t &num_zorros, size_t &num_rocas) const {
+        num_conejos = num_zorros = num_rocas = 0;
+        for (int hueco : vivos) {
+            num_conejos += trozos[hueco]->conejos.size();
+            num_zorros += trozos[hueco]->zorros.size();
+            num_rocas += trozos[hueco]->num_rocas;
+        }
+    }
+
+    // Trozos vivos agrupados por fila de trozos y ordenados por columna
+    vector<vector<int>> filas_de_trozos() const {
+        vector<pair<uint64_t, int>> orden;
+        for (int hueco : vivos) {
+            orden.push_back({clave_trozo(trozos[hueco]->ti, trozos[hueco]->tj), hueco});
+        }
+        sort(orden.begin(), orden.end());
+        vector<vector<int>> grupos;
+        int ti_anterior = -1;
+        for (const pair<uint64_t, int> &o : orden) {
+            if (trozos[o.second]->ti != ti_anterior) {
+                grupos.emplace_back();
+                ti_anterior = trozos[o.second]->ti;
+            }
+            grupos.back().push_back(o.second);
+        }
+        return grupos;
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz.redimensionar(filas, columnas, VACIO, ROCA);
+        conejos.clear();
+        zorros.clear();
+        for (const vector<int> &grupo : filas_de_trozos()) {
+            for (int hueco : grupo) {
+                const Trozo &trozo = *trozos[hueco];
+                for (int i = 0; i < trozo.filas; i++) {
+                    copy(trozo.celdas.fila(i), trozo.celdas.fila(i) + trozo.columnas, &mundo.matriz(trozo.f0 + i, trozo.c0));
+                }
+                conejos.insert(conejos.end(), trozo.conejos.begin(), trozo.conejos.end());
+                zorros.insert(zorros.end(), trozo.zorros.begin(), trozo.zorros.end());
+            }
+        }
+        sort(conejos.begin(), conejos.end(), por_posicion);
+        sort(zorros.begin(), zorros.end(), por_posicion);
+    }
+
+    // Igual que escribir_texto, pero recorriendo solo los trozos vivos. Cada
+    // fila de trozos se formatea en paralelo en su búfer y se escriben en orden.
+    void escribir_texto(ofstream &archivo_salida, const Parametros &params, int ultima_generacion) const {
+        size_t num_conejos, num_zorros, num_rocas;
+        poblaciones(num_conejos, num_zorros, num_rocas);
+        archivo_salida << params.gen_proc_conejos << " " << params.gen_proc_zorros << " "
+                       << params.gen_comida_zorros << " " << ultima_generacion << " "
+                       << filas << " " << columnas << " " << num_conejos + num_zorros + num_rocas << "\n";
+
+        vector<vector<int>> grupos = filas_de_trozos();
+        int por_tanda = omp_get_max_threads() * 2;
+        vector<string> buferes(por_tanda);
+        for (size_t primero = 0; primero < grupos.size(); primero += por_tanda) {
+            int en_tanda = min<size_t>(por_tanda, grupos.size() - primero);
+
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int b = 0; b < en_tanda; b++) {
+                const vector<int> &grupo = grupos[primero + b];
+                string &bufer = buferes[b];
+                bufer.clear();
+                int alto = trozos[grupo[0]]->filas;
+                for (int i = 0; i < alto; i++) {
+                    for (int hueco : grupo) {
+                        const Trozo &trozo = *trozos[hueco];
+                        const uint8_t *fila = trozo.celdas.fila(i);
+                        for (int j = 0; j < trozo.columnas; j++) {
+                            if (fila[j] == ROCA) {
+                                formatear_objeto(bufer, "ROCK", 4, trozo.f0 + i, trozo.c0 + j);
+                            } else if (fila[j] == CONEJO) {
+                                formatear_objeto(bufer, "RABBIT", 6, trozo.f0 + i, trozo.c0 + j);
+                            } else if (fila[j] == ZORRO) {
+                                formatear_objeto(bufer, "FOX", 3, trozo.f0 + i, trozo.c0 + j);
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (int b = 0; b < en_tanda; b++) {
+                archivo_salida.write(buferes[b].data(), buferes[b].size());
+            }
+        }
+        archivo_salida.flush();
+    }
+};
+
+// Entidad empaquetada del motor compacto, 32 bits por celda:
+//   bit 31      zorro
+//   bits 30..16 edad de reproducción + 1, saturada a 15 bits
+//   bits 15..0  hambre invertida
+// Es a la vez el dato del animal y su clave de reclamo: el máximo gana como con
+// clave_prioridad y cualquier zorro gana a cualquier conejo. 0 es celda sin animal.
+const uint32_t ENTIDAD_ZORRO = 1u << 31;
+const uint32_t EDAD_MAXIMA_COMPACTA = 0x7FFF - 1;
+const uint32_t HAMBRE_MAXIMA_COMPACTA = 0xFFFF;
+
+inline uint32_t empaquetar_entidad(bool zorro, int edad_reproduccion, int hambre) {
+    uint32_t edad = (uint32_t)min(edad_reproduccion, (int)EDAD_MAXIMA_COMPACTA) + 1;
+    return (zorro ? ENTIDAD_ZORRO : 0) | edad << 16 | (uint32_t)(0xFFFF - hambre);
+}
+
+inline int edad_de_entidad(uint32_t entidad) {
+    return (int)((entidad >> 16) & 0x7FFF) - 1;
+}
+
+inline int hambre_de_entidad(uint32_t entidad) {
+    return 0xFFFF - (int)(entidad & 0xFFFF);
+}
+
+inline void reclamar_entidad(uint32_t &celda, uint32_t entidad) {
+    #pragma omp atomic compare
+    if (celda < entidad) { celda = entidad; }
+}
+
+// Motor compacto: sin vectores de animales ni rejillas de reclamos. El mundo son
+// dos planos, el estado (1 byte) y la entidad (4 bytes), y ambos se actualizan
+// en el sitio. En cada fase cada animal escribe en su propia celda lo que queda
+// en ella (él mismo si no se mueve, una cría o nada) y reclama su destino con un
+// máximo atómico. Los destinos son siempre celdas que ningún otro animal de la
+// fase lee, así que leer y reclamar en el mismo barrido es seguro. Después un
+// barrido por celdas pasa las entidades ganadoras al plano de estado.
+// La edad se satura en EDAD_MAXIMA_COMPACTA y el hambre usa 16 bits, así que
+// validar_parametros rechaza este motor con parámetros fuera de esos rangos.
+struct MotorCompacto : Motor {
+    int filas = 0;
+    int columnas = 0;
+    Rejilla<uint8_t> estado;
+    Rejilla<uint32_t> entidad;
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        filas = mundo.filas;
+        columnas = mundo.columnas;
+        estado = mundo.matriz;
+        entidad.redimensionar(filas, columnas, 0, 0);
+        for (const Conejo &c : conejos) {
+            entidad(c.x, c.y) = empaquetar_entidad(false, c.edad_reproduccion, 0);
+        }
+        for (const Zorro &z : zorros) {
+            entidad(z.x, z.y) = empaquetar_entidad(true, z.edad_reproduccion, z.hambre);
+        }
+    }
+
+    void mover_conejos_compacto(const Parametros &params, int generacion_actual) {
+        #pragma omp parallel for schedule(dynamic, 8)
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            uint32_t *entidades = entidad.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] != CONEJO) {
+                    continue;
+                }
+                int edad = edad_de_entidad(entidades[j]);
+                unsigned vacias = mascara_adyacentes(estado, i, j, VACIO);
+                if (!vacias) {
+                    entidades[j] = empaquetar_entidad(false, edad + 1, 0);
+                    continue;
+                }
+                int d = elegir_direccion(vacias, i, j, generacion_actual);
+                if (edad >= params.gen_proc_conejos) {
+                    entidades[j] = empaquetar_entidad(false, 0, 0);  // La cría
+                    edad = 0;
+                } else {
+                    entidades[j] = 0;
+                    edad++;
+                }
+                reclamar_entidad(entidad(i + DIR_FILA[d], j + DIR_COLUMNA[d]), empaquetar_entidad(false, edad, 0));
+            }
+        }
+
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *celdas = estado.fila(i);
+            const uint32_t *entidades = entidad.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (entidades[j] != 0 && celdas[j] != ZORRO) {
+                    celdas[j] = CONEJO;
+                } else if (celdas[j] == CONEJO) {
+                    celdas[j] = VACIO;
+                }
+            }
+        }
+    }
+
+    void mover_zorros_compacto(const Parametros &params, int generacion_actual) {
+        #pragma omp parallel for schedule(dynamic, 8)
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            uint32_t *entidades = entidad.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] != ZORRO) {
+                    continue;
+                }
+                int edad = edad_de_entidad(entidades[j]);
+                int hambre = hambre_de_entidad(entidades[j]);
+                unsigned mascara = mascara_adyacentes(estado, i, j, CONEJO);
+                if (mascara) {
+                    hambre = 0;
+                } else {
+                    hambre++;
+                    if (hambre >= params.gen_comida_zorros) {
+                        entidades[j] = 0;
+                        continue;
+                    }
+                    mascara = mascara_adyacentes(estado, i, j, VACIO);
+                }
+                if (!mascara) {
+                    entidades[j] = empaquetar_entidad(true, edad + 1, hambre);
+                    continue;
+                }
+                int d = elegir_direccion(mascara, i, j, generacion_actual);
+                if (edad >= params.gen_proc_zorros) {
+                    entidades[j] = empaquetar_entidad(true, 0, 0);  // La cría
+                    edad = 0;
+                } else {
+                    entidades[j] = 0;
+                    edad++;
+                }
+                // Sobre un conejo el bit de zorro gana siempre: se lo come
+                reclamar_entidad(entidad(i + DIR_FILA[d], j + DIR_COLUMNA[d]), empaquetar_entidad(true, edad, hambre));
+            }
+        }
+
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *celdas = estado.fila(i);
+            const uint32_t *entidades = entidad.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (entidades[j] & ENTIDAD_ZORRO) {
+                    celdas[j] = ZORRO;
+                } else if (celdas[j] == ZORRO) {
+                    celdas[j] = VACIO;
+                }
+            }
+        }
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        mover_conejos_compacto(params, generacion_actual);
+        mover_zorros_compacto(params, generacion_actual);
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz = estado;
+        conejos.clear();
+        zorros.clear();
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            const uint32_t *entidades = entidad.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] == CONEJO) {
+                    conejos.push_back({i, j, edad_de_entidad(entidades[j])});
+                } else if (celdas[j] == ZORRO) {
+                    zorros.push_back({i, j, edad_de_entidad(entidades[j]), hambre_de_entidad(entidades[j])});
+                }
+            }
+        }
+    }
+
+    void exportar_celdas(Mundo &mundo, size_t &num_conejos, size_t &num_zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz = estado;
+        size_t conejos = 0;
+        size_t zorros = 0;
+        #pragma omp parallel for reduction(+:conejos, zorros)
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                conejos += celdas[j] == CONEJO;
+                zorros += celdas[j] == ZORRO;
+            }
+        }
+        num_conejos = conejos;
+        num_zorros = zorros;
+    }
+
+    // La copia y el recuento en una sola pasada
+    void copiar_celdas(uint8_t *destino, size_t &num_conejos, size_t &num_zorros) override {
+        size_t conejos = 0;
+        size_t zorros = 0;
+        #pragma omp parallel for reduction(+:conejos, zorros)
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            uint8_t *fila = destino + (size_t)i * columnas;
+            for (int j = 0; j < columnas; j++) {
+                fila[j] = celdas[j];
+                conejos += celdas[j] == CONEJO;
+                zorros += celdas[j] == ZORRO;
+            }
+        }
+        num_conejos = conejos;
+        num_zorros = zorros;
+    }
+};
+
+// Motor de especies: una red trófica declarada en un archivo en vez de los
+// conejos y zorros fijos. Cada especie se mueve en su propia fase, en el orden
+// en que se declaran, con las reglas de siempre generalizadas: si come y tiene
+// presas al lado va hacia una y se la come, si no pasa hambre (si puede morir
+// de ella) y busca una celda vacía; al moverse con la edad de reproducción deja
+// una cría en la celda de origen; los conflictos los gana la clave mayor. Las
+// especies quietas no se mueven: su cría va a una celda vacía vecina.
+// Los estados del mundo de las especies se saltan ROCA, así la primera especie
+// es CONEJO y la segunda ZORRO; sin archivo el motor simula exactamente esas
+// dos con los parámetros de siempre.
+const int MAX_ESPECIES = 30;  // Estados 1, 2 y 4..31: las presas caben en una máscara de 32 bits
+
+inline uint8_t estado_de_especie(int s) {
+    return s < 2 ? s + 1 : s + 2;
+}
+
+struct Especie {
+    string nombre;
+    int gen_proc = 1;       // Generaciones hasta que puede procrear
+    int gen_comida = 0;     // Generaciones sin comer hasta morir; 0 si no muere de hambre
+    uint32_t presas = 0;    // Bit e encendido si come a la especie con estado e
+    bool quieta = false;
+};
+
+// Individuos de una especie en estructura de arreglos, en orden de filas
+struct Poblacion {
+    vector<int> x;
+    vector<int> y;
+    vector<int> edad;
+    vector<int> hambre;
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        edad.resize(n);
+        hambre.resize(n);
+    }
+};
+
+// Bit d encendido si el vecino en la dirección d es de una especie de la máscara
+inline unsigned mascara_presas(const Rejilla<uint8_t> &estado, int x, int y, uint32_t presas) {
+    const uint8_t *centro = &estado(x, y);
+    size_t paso = estado.paso;
+    return (presas >> *(centro - paso) & 1)
+         | (presas >> *(centro + 1) & 1) << 1
+         | (presas >> *(centro + paso) & 1) << 2
+         | (presas >> *(centro - 1) & 1) << 3;
+}
+
+// Lee la red trófica. Una especie por línea, en el orden de sus fases:
+//   NOMBRE reproduccion=N [hambre=N] [come=A,B...] [quieta]
+// NOMBRE es la palabra de la especie en los archivos del mundo. '#' empieza un
+// comentario. Devuelve un mensaje de error o una cadena vacía.
+string leer_especies(const string &ruta, vector<Especie> &especies) {
+    ifstream archivo(ruta);
+    if (!archivo.is_open()) {
+        return "No se pudo abrir el archivo de especies: " + ruta;
+    }
+    vector<vector<string>> comidas;
+    string linea;
+    int numero = 0;
+    while (getline(archivo, linea)) {
+        numero++;
+        linea = linea.substr(0, linea.find('#'));
+        istringstream campos(linea);
+        Especie especie;
+        if (!(campos >> especie.nombre)) {
+            continue;
+        }
+        string error = "Linea " + to_string(numero) + " de " + ruta + " no valida: " + linea;
+        if (especie.nombre == "ROCK") {
+            return error;
+        }
+        for (const Especie &otra : especies) {
+            if (otra.nombre == especie.nombre) {
+                return error;
+            }
+        }
+        vector<string> come;
+        bool con_reproduccion = false;
+        string campo;
+        while (campos >> campo) {
+            if (campo.rfind("reproduccion=", 0) == 0) {
+                especie.gen_proc = atoi(campo.c_str() + 13);
+                con_reproduccion = especie.gen_proc >= 0;
+            } else if (campo.rfind("hambre=", 0) == 0) {
+                especie.gen_comida = atoi(campo.c_str() + 7);
+                if (especie.gen_comida < 1) {
+                    return error;
+                }
+            } else if (campo.rfind("come=", 0) == 0) {
+                istringstream nombres(campo.substr(5));
+                string nombre;
+                while (getline(nombres, nombre, ',')) {
+                    come.push_back(nombre);
+                }
+            } else if (campo == "quieta") {
+                especie.quieta = true;
+            } else {
+                return error;
+            }
+        }
+        if (!con_reproduccion || (especie.quieta && !come.empty())) {
+            return error;
+        }
+        especies.push_back(especie);
+        comidas.push_back(come);
+    }
+    if (especies.empty() || especies.size() > (size_t)MAX_ESPECIES) {
+        return "El archivo de especies debe declarar entre 1 y " + to_string(MAX_ESPECIES) + " especies: " + ruta;
+    }
+    for (size_t s = 0; s < especies.size(); s++) {
+        for (const string &nombre : comidas[s]) {
+            size_t p = 0;
+            while (p < especies.size() && especies[p].nombre != nombre) {
+                p++;
+            }
+            if (p == especies.size() || p == s) {
+                return "La especie " + especies[s].nombre + " no puede comer a " + nombre;
+            }
+            especies[s].presas |= 1u << estado_de_especie(p);
+        }
+    }
+    return "";
+}
+
+struct MotorEspecies : Motor {
+    int filas = 0;
+    int columnas = 0;
+    vector<Especie> especies;
+    bool desde_parametros = true;   // Conejos y zorros con los parámetros de la simulación
+    Rejilla<uint8_t> estado;
+    vector<Poblacion> poblaciones;
+    Rejilla<uint64_t> reclamos;     // Claves selladas, compartidas por todas las fases
+    PlanoBits nacimientos;          // Se apagan al recogerlos
+    vector<size_t> por_fila;
+    uint64_t sello = 0;
+
+    MotorEspecies() {
+        especies.resize(2);
+        especies[0].nombre = "RABBIT";
+        especies[1].nombre = "FOX";
+        especies[1].presas = 1u << CONEJO;
+    }
+
+    explicit MotorEspecies(const vector<Especie> &e) : especies(e), desde_parametros(false) {}
+
+    void preparar(const Mundo &mundo) {
+        filas = mundo.filas;
+        columnas = mundo.columnas;
+        estado = mundo.matriz;
+        reclamos.redimensionar(filas, columnas, 0, 0);
+        nacimientos.redimensionar(filas, columnas);
+        por_fila.resize(filas);
+        poblaciones.assign(especies.size(), Poblacion());
+        sello = 0;
+    }
+
+    // Reparte las celdas de cada especie en su población, en orden de filas
+    void poblar() {
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            for (int j = 0; j < columnas; j++) {
+                for (size_t s = 0; s < especies.size(); s++) {
+                    if (celdas[j] == estado_de_especie(s)) {
+                        Poblacion &p = poblaciones[s];
+                        p.x.push_back(i);
+                        p.y.push_back(j);
+                        p.edad.push_back(0);
+                        p.hambre.push_back(0);
+                    }
+                }
+            }
+        }
+    }
+
+    void cargar(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros) override {
+        preparar(mundo);
+        Poblacion &c = poblaciones[0];
+        Poblacion &z = poblaciones[1];
+        for (const Conejo &conejo : conejos) {
+            c.x.push_back(conejo.x);
+            c.y.push_back(conejo.y);
+            c.edad.push_back(conejo.edad_reproduccion);
+            c.hambre.push_back(0);
+        }
+        for (const Zorro &zorro : zorros) {
+            z.x.push_back(zorro.x);
+            z.y.push_back(zorro.y);
+            z.edad.push_back(zorro.edad_reproduccion);
+            z.hambre.push_back(zorro.hambre);
+        }
+    }
+
+    // Núcleo de una fase, instanciado según lo que hace la especie para que el
+    // caso de los conejos no pague las comprobaciones de los depredadores
+    template <bool COME, bool PASA_HAMBRE, bool QUIETA>
+    void mover_especie(int s, int generacion_actual) {
+        const Especie &especie = especies[s];
+        Poblacion &p = poblaciones[s];
+        int n = p.size();
+        uint64_t sello_fase = sello;
+
+        #pragma omp parallel for schedule(dynamic, 8)
+        for (int i = 0; i < n; i++) {
+            int x = p.x[i];
+            int y = p.y[i];
+            int edad = p.edad[i];
+            int hambre = p.hambre[i];
+
+            unsigned mascara = 0;
+            if (COME) {
+                mascara = mascara_presas(estado, x, y, especie.presas);
+                if (mascara) {
+                    hambre = 0;
+                }
+            }
+            if (!mascara) {
+                if (PASA_HAMBRE) {
+                    hambre++;
+                    if (hambre >= especie.gen_comida) {
+                        continue;
+                    }
+                }
+                mascara = mascara_adyacentes(estado, x, y, VACIO);
+            }
+
+            if (QUIETA) {
+                if (mascara && edad >= especie.gen_proc) {
+                    int d = elegir_direccion(mascara, x, y, generacion_actual);
+                    reclamar_celda(reclamos(x + DIR_FILA[d], y + DIR_COLUMNA[d]), clave_sellada(sello_fase, 0, 0));
+                    edad = 0;
+                } else {
+                    edad++;
+                }
+                reclamos(x, y) = clave_sellada(sello_fase, edad, hambre);
+                continue;
+            }
+
+            int x_nuevo = x;
+            int y_nuevo = y;
+            if (mascara) {
+                int d = elegir_direccion(mascara, x, y, generacion_actual);
+                x_nuevo += DIR_FILA[d];
+                y_nuevo += DIR_COLUMNA[d];
+            }
+            if (edad >= especie.gen_proc && mascara) {
+                nacimientos.encender(x, y);
+                edad = 0;
+            } else {
+                edad++;
+            }
+            reclamar_celda(reclamos(x_nuevo, y_nuevo), clave_sellada(sello_fase, edad, hambre));
+        }
+    }
+
+    // Coloca a los ganadores y las crías de la especie y rehace su población
+    // en orden de filas, en dos pasadas como en mover_conejos
+    void recoger_especie(int s) {
+        uint8_t propio = estado_de_especie(s);
+        Poblacion &p = poblaciones[s];
+        uint64_t sello_fase = sello;
+
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            uint8_t *celdas = estado.fila(i);
+            const uint64_t *claves = reclamos.fila(i);
+            uint64_t *nacidos = nacimientos.fila(i);
+            size_t cuenta = 0;
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] == propio) {
+                    celdas[j] = VACIO;
+                }
+                // Un ganador ocupa la celda aunque haya una presa: se la come
+                if (sello_de_clave(claves[j]) == sello_fase || (celdas[j] == VACIO && PlanoBits::leer_en_fila(nacidos, j))) {
+                    celdas[j] = propio;
+                    cuenta++;
+                }
+            }
+            fill(nacidos, nacidos + nacimientos.palabras, 0);
+            por_fila[i] = cuenta;
+        }
+
+        p.resize(suma_prefija_exclusiva(por_fila));
+
+        #pragma omp parallel for
+        for (int i = 0; i < filas; i++) {
+            const uint8_t *celdas = estado.fila(i);
+            const uint64_t *claves = reclamos.fila(i);
+            size_t k = por_fila[i];
+            for (int j = 0; j < columnas; j++) {
+                if (celdas[j] == propio) {
+                    bool reclamada = sello_de_clave(claves[j]) == sello_fase;
+                    p.x[k] = i;
+                    p.y[k] = j;
+                    p.edad[k] = reclamada ? edad_de_clave_sellada(claves[j]) : 0;
+                    p.hambre[k] = reclamada ? hambre_de_clave_sellada(claves[j]) : 0;
+                    k++;
+                }
+            }
+        }
+    }
+
+    // Quita de la población a los que ya no están en su celda (se los comieron)
+    void quitar_comidos(int s) {
+        uint8_t propio = estado_de_especie(s);
+        Poblacion &p = poblaciones[s];
+        size_t vivos = 0;
+        for (size_t k = 0; k < p.size(); k++) {
+            if (estado(p.x[k], p.y[k]) == propio) {
+                p.x[vivos] = p.x[k];
+                p.y[vivos] = p.y[k];
+                p.edad[vivos] = p.edad[k];
+                p.hambre[vivos] = p.hambre[k];
+                vivos++;
+            }
+        }
+        p.resize(vivos);
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        typedef void (MotorEspecies::*Nucleo)(int, int);
+        // Indexada por [come][pasa hambre][quieta]
+        static const Nucleo nucleos[2][2][2] = {
+            {{&MotorEspecies::mover_especie<false, false, false>, &MotorEspecies::mover_especie<false, false, true>},
+             {&MotorEspecies::mover_especie<false, true, false>, &MotorEspecies::mover_especie<false, true, true>}},
+            {{&MotorEspecies::mover_especie<true, false, false>, &MotorEspecies::mover_especie<true, false, true>},
+             {&MotorEspecies::mover_especie<true, true, false>, &MotorEspecies::mover_especie<true, true, true>}},
+        };
+
+        if (desde_parametros) {
+            especies[0].gen_proc = params.gen_proc_conejos;
+            especies[1].gen_proc = params.gen_proc_zorros;
+            // Con 0 el zorro muere en la misma generación, igual que con 1
+            especies[1].gen_comida = max(1, params.gen_comida_zorros);
+        }
+
+        for (size_t s = 0; s < especies.size(); s++) {
+            const Especie &especie = especies[s];
+            if (sello == SELLO_MAXIMO) {
+                reclamos.redimensionar(filas, columnas, 0, 0);
+                sello = 0;
+            }
+            sello++;
+            (this->*nucleos[especie.presas != 0][especie.gen_comida > 0][especie.quieta])(s, generacion_actual);
+            recoger_especie(s);
+            for (size_t p = 0; p < especies.size(); p++) {
+                if (especie.presas >> estado_de_especie(p) & 1) {
+                    quitar_comidos(p);
+                }
+            }
+        }
+    }
+
+    void exportar(Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros) override {
+        mundo.filas = filas;
+        mundo.columnas = columnas;
+        mundo.matriz = estado;
+        conejos.clear();
+        zorros.clear();
+        const Poblacion &c = poblaciones[0];
+        for (size_t k = 0; k < c.size(); k++) {
+            conejos.push_back({c.x[k], c.y[k], c.edad[k]});
+        }
+        if (poblaciones.size() > 1) {
+            const Poblacion &z = poblaciones[1];
+            for (size_t k = 0; k < z.size(); k++) {
+                zorros.push_back({z.x[k], z.y[k], z.edad[k], z.hambre[k]});
+            }
+        }
+    }
+};
+
+// Motor de referencia: la versión secuencial de proyecto.cpp sin cambios de
+// lógica (orden de proceso, empates, borrado de conejos comidos). No comparte
+// código con los demás motores, así sirve de patrón para verificarlos.
+struct MotorReferencia : Motor {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    vector<vector<Conejo>> conejos_nuevos;
+    vector<vector<Zorro>> zorros_nuevos;
+    int vecindad = VECINDAD_VON_NEUMANN;
+    int contorno = CONTORNO_ACOTADO;
+
+    void cargar(const Mundo &m, const vector<Conejo> &c, const vector<Zorro> &z) override {
+        mundo = m;
+        conejos = c;
+        zorros = z;
+        conejos_nuevos.assign(mundo.filas, vector<Conejo>(mundo.columnas));
+        zorros_nuevos.assign(mundo.filas, vector<Zorro>(mundo.columnas));
+    }
+
+    void avanzar(const Parametros &params, int generacion_actual) override {
+        vecindad = params.vecindad;
+        contorno = params.contorno;
+        for (int i = 0; i < mundo.filas; i++) {
+            for (int j = 0; j < mundo.columnas; j++) {
+                conejos_nuevos[i][j].edad_reproduccion = -1; // Marca como no válido
+                zorros_nuevos[i][j].edad_reproduccion = -1;  // Marca como no válido
+            }
+        }
+        mover_conejos_referencia(params, generacion_actual);
+        mover_zorros_referencia(params, generacion_actual);
+    }
+
+    // Los conejos comidos se borran intercambiando con el último, así que el
+    // vector se ordena por filas para entregarlo como los demás motores
+    void exportar(Mundo &m, vector<Conejo> &c, vector<Zorro> &z) override {
+        m = mundo;
+        c = conejos;
+        z = zorros;
+        sort(c.begin(), c.end(), [](const Conejo &a, const Conejo &b) {
+            return a.x != b.x ? a.x < b.x : a.y < b.y;
+        });
+    }
+
+    // Vecinos en el sentido de las agujas del reloj desde arriba: los cuatro
+    // de von Neumann o, con Moore, también las diagonales. En el contorno
+    // toroidal los que salen del mundo entran por el lado opuesto.
+    vector<pair<int, int>> adyacentes(int x, int y, int estado) const {
+        static const int fila_moore[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+        static const int columna_moore[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+        vector<pair<int, int>> celdas;
+        int paso = vecindad == VECINDAD_MOORE ? 1 : 2;
+        for (int d = 0; d < 8; d += paso) {
+            int i = x + fila_moore[d];
+            int j = y + columna_moore[d];
+            if (contorno == CONTORNO_TOROIDAL) {
+                i = (i + mundo.filas) % mundo.filas;
+                j = (j + mundo.columnas) % mundo.columnas;
+            } else if (i < 0 || i >= mundo.filas || j < 0 || j >= mundo.columnas) {
+                continue;
+            }
+            if (mundo.matriz(i, j) == estado)
+                celdas.push_back(make_pair(i, j));
+        }
+        return celdas;
+    }
+
+    static pair<int, int> destino(int x, int y, const vector<pair<int, int>> &celdas, int generacion_actual) {
+        return celdas[(generacion_actual + x + y) % celdas.size()];
+    }
+
+    void mover_conejos_referencia(const Parametros &params, int generacion_actual) {
+        vector<vector<bool>> hay_conejo_nuevo(mundo.filas, vector<bool>(mundo.columnas, false));
+        for (size_t i = 0; i < conejos.size(); i++) {
+            int x_viejo = conejos[i].x;
+            int y_viejo = conejos[i].y;
+            vector<pair<int, int>> celdas_adyacentes = adyacentes(x_viejo, y_viejo, VACIO);
+
+            if (!celdas_adyacentes.empty()) {
+                pair<int, int> d = destino(x_viejo, y_viejo, celdas_adyacentes, generacion_actual);
+                if (conejos[i].edad_reproduccion >= params.gen_proc_conejos) {
+                    hay_conejo_nuevo[x_viejo][y_viejo] = true;
+                    conejos[i].edad_reproduccion = 0;
+                } else {
+                    conejos[i].edad_reproduccion++;
+                }
+                conejos[i].x = d.first;
+                conejos[i].y = d.second;
+                Conejo &otro = conejos_nuevos[d.first][d.second];
+                if (otro.edad_reproduccion == -1 || conejos[i].edad_reproduccion > otro.edad_reproduccion) {
+                    otro = conejos[i];
+                }
+            } else {
+                conejos[i].edad_reproduccion++;
+                conejos_nuevos[x_viejo][y_viejo] = conejos[i];
+            }
+        }
+
+        conejos.clear();
+        for (int i = 0; i < mundo.filas; i++) {
+            for (int j = 0; j < mundo.columnas; j++) {
+                if (mundo.matriz(i, j) == CONEJO) {
+                    mundo.matriz(i, j) = VACIO;
+                }
+                if (conejos_nuevos[i][j].edad_reproduccion != -1) {
+                    conejos.push_back(conejos_nuevos[i][j]);
+                    mundo.matriz(i, j) = CONEJO;
+                }
+                if (hay_conejo_nuevo[i][j] && mundo.matriz(i, j) == VACIO) {
+                    conejos.push_back({i, j, 0});
+                    mundo.matriz(i, j) = CONEJO;
+                }
+            }
+        }
+    }
+
+    void mover_zorros_referencia(const Parametros &params, int generacion_actual) {
+        vector<vector<bool>> hay_zorro_nuevo(mundo.filas, vector<bool>(mundo.columnas, false));
+        for (size_t i = 0; i < zorros.size(); i++) {
+            int x_viejo = zorros[i].x;
+            int y_viejo = zorros[i].y;
+            vector<pair<int, int>> celdas_con_conejos = adyacentes(x_viejo, y_viejo, CONEJO);
+            vector<pair<int, int>> celdas_adyacentes = adyacentes(x_viejo, y_viejo, VACIO);
+            bool murio = false;
+            int x_nuevo = x_viejo;
+            int y_nuevo = y_viejo;
+
+            if (!celdas_con_conejos.empty()) {
+                pair<int, int> d = destino(x_viejo, y_viejo, celdas_con_conejos, generacion_actual);
+                x_nuevo = d.first;
+                y_nuevo = d.second;
+                zorros[i].hambre = 0;
+                for (size_t j = 0; j < conejos.size(); j++) {
+                    if (conejos[j].x == x_nuevo && conejos[j].y == y_nuevo) {
+                        conejos[j] = conejos.back();
+                        conejos.pop_back();
+                        break;
+                    }
+                }
+            } else {
+                zorros[i].hambre++;
+                if (zorros[i].hambre >= params.gen_comida_zorros) {
+                    murio = true;
+                } else if (!celdas_adyacentes.empty()) {
+                    pair<int, int> d = destino(x_viejo, y_viejo, celdas_adyacentes, generacion_actual);
+                    x_nuevo = d.first;
+                    y_nuevo = d.second;
+                }
+            }
+
+            if (!murio) {
+                if (zorros[i].edad_reproduccion >= params.gen_proc_zorros && (x_nuevo != x_viejo || y_nuevo != y_viejo)) {
+                    hay_zorro_nuevo[x_viejo][y_viejo] = true;
+                    zorros[i].edad_reproduccion = 0;
+                } else {
+                    zorros[i].edad_reproduccion++;
+                }
+                zorros[i].x = x_nuevo;
+                zorros[i].y = y_nuevo;
+                Zorro &otro = zorros_nuevos[x_nuevo][y_nuevo];
+                if (otro.edad_reproduccion == -1 || zorros[i].edad_reproduccion > otro.edad_reproduccion ||
+                    (zorros[i].edad_reproduccion == otro.edad_reproduccion && zorros[i].hambre < otro.hambre)) {
+                    otro = zorros[i];
+                }
+            }
+        }
+
+        zorros.clear();
+        for (int i = 0; i < mundo.filas; i++) {
+            for (int j = 0; j < mundo.columnas; j++) {
+                if (mundo.matriz(i, j) == ZORRO) {
+                    mundo.matriz(i, j) = VACIO;
+                }
+                if (zorros_nuevos[i][j].edad_reproduccion != -1) {
+                    zorros.push_back(zorros_nuevos[i][j]);
+                    mundo.matriz(i, j) = ZORRO;
+                }
+                if (hay_zorro_nuevo[i][j] && mundo.matriz(i, j) == VACIO) {
+                    zorros.push_back({i, j, 0, 0});
+                    mundo.matriz(i, j) = ZORRO;
+                }
+            }
+        }
+    }
+};
+
+unique_ptr<Motor> crear_motor(const Parametros &params) {
+    int motor = params.motor;
+    if (motor == MOTOR_RECOLECCION) {
+        return unique_ptr<Motor>(new MotorRecoleccion());
+    }
+    if (motor == MOTOR_BITBOARD) {
+        return unique_ptr<Motor>(new MotorBitboard());
+    }
+    if (motor == MOTOR_TESELAS) {
+        return unique_ptr<Motor>(new MotorTeselas());
+    }
+    if (motor == MOTOR_DISTRIBUIDO) {
+        return unique_ptr<Motor>(new MotorDistribuido(params.num_procesos));
+    }
+    if (motor == MOTOR_REFERENCIA) {
+        return unique_ptr<Motor>(new MotorReferencia());
+    }
+    if (motor == MOTOR_DISPERSO) {
+        return unique_ptr<Motor>(new MotorDisperso());
+    }
+    if (motor == MOTOR_COMPACTO) {
+        return unique_ptr<Motor>(new MotorCompacto());
+    }
+    if (motor == MOTOR_ESPECIES) {
+        return unique_ptr<Motor>(new MotorEspecies());
+    }
+    return unique_ptr<Motor>(new MotorEntidades());
+}
+
+// Generador determinista de mundos: el contenido de cada celda depende solo de
+// la semilla y de su posición, así el mismo mundo sale con cualquier número de
+// hilos. Las densidades son fracciones de celdas con rocas, conejos y zorros.
+struct Densidades {
+    double rocas = 0.05;
+    double conejos = 0.30;
+    double zorros = 0.05;
+};
+
+inline uint64_t mezclar(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void generar_mundo(int filas, int columnas, const Densidades &densidades, uint64_t semilla,
+                   Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros, int &num_rocas) {
+    mundo.filas = filas;
+    mundo.columnas = columnas;
+    mundo.matriz.redimensionar(filas, columnas, VACIO, ROCA);
+    const double escala = 1.0 / 9007199254740992.0;  // 2^-53
+
+    #pragma omp parallel for
+    for (int i = 0; i < filas; i++) {
+        uint8_t *fila = mundo.matriz.fila(i);
+        for (int j = 0; j < columnas; j++) {
+            double u = (mezclar(semilla ^ mezclar((uint64_t)i * columnas + j)) >> 11) * escala;
+            if (u < densidades.rocas) {
+                fila[j] = ROCA;
+            } else if (u < densidades.rocas + densidades.conejos) {
+                fila[j] = CONEJO;
+            } else if (u < densidades.rocas + densidades.conejos + densidades.zorros) {
+                fila[j] = ZORRO;
+            } else {
+                fila[j] = VACIO;
+            }
+        }
+    }
+
+    conejos.clear();
+    zorros.clear();
+    num_rocas = 0;
+    for (int i = 0; i < filas; i++) {
+        const uint8_t *fila = mundo.matriz.fila(i);
+        for (int j = 0; j < columnas; j++) {
+            if (fila[j] == ROCA) {
+                num_rocas++;
+            } else if (fila[j] == CONEJO) {
+                conejos.push_back({i, j, 0});
+            } else if (fila[j] == ZORRO) {
+                zorros.push_back({i, j, 0, 0});
+            }
+        }
+    }
+}
+
+// Opciones del banco de pruebas
+struct OpcionesBanco {
+    string modo = "escalado";          // "escalado" o "micro"
+    vector<int> tamanos = {256, 512, 1024};
+    vector<int> hilos;                 // Por defecto potencias de dos hasta el máximo
+    int generaciones = 50;
+    int repeticiones = 3;              // Se informa la mejor de las repeticiones
+    uint64_t semilla = 1;
+    Densidades densidades;
+    Parametros params;
+};
+
+vector<double> leer_lista(const string &texto) {
+    vector<double> valores;
+    size_t inicio = 0;
+    while (inicio <= texto.size()) {
+        size_t fin = texto.find(',', inicio);
+        if (fin == string::npos) {
+            fin = texto.size();
+        }
+        valores.push_back(atof(texto.substr(inicio, fin - inicio).c_str()));
+        inicio = fin + 1;
+    }
+    return valores;
+}
+
+int buscar_motor(const string &nombre) {
+    for (int m = 0; m < NUM_MOTORES; m++) {
+        if (nombre == NOMBRES_MOTORES[m]) {
+            return m;
+        }
+    }
+    return -1;
+}
+
+bool leer_opciones_banco(int argc, char* argv[], OpcionesBanco &opciones) {
+    opciones.params.gen_proc_conejos = 3;
+    opciones.params.gen_proc_zorros = 8;
+    opciones.params.gen_comida_zorros = 5;
+    for (int i = 2; i < argc; i++) {
+        string opcion = argv[i];
+        if (opcion == "escalado" || opcion == "micro") {
+            opciones.modo = opcion;
+        } else if (opcion.rfind("--motor=", 0) == 0) {
+            opciones.params.motor = buscar_motor(opcion.substr(8));
+            if (opciones.params.motor == -1) {
+                cout << "Error: Motor desconocido: " << opcion.substr(8) << endl;
+                return false;
+            }
+        } else if (opcion.rfind("--procesos=", 0) == 0) {
+            opciones.params.num_procesos = max(1, atoi(opcion.c_str() + 11));
+        } else if (opcion.rfind("--tamanos=", 0) == 0) {
+            opciones.tamanos.clear();
+            for (double t : leer_lista(opcion.substr(10))) {
+                opciones.tamanos.push_back(max(1, (int)t));
+            }
+        } else if (opcion.rfind("--hilos=", 0) == 0) {
+            opciones.hilos.clear();
+            for (double h : leer_lista(opcion.substr(8))) {
+                opciones.hilos.push_back(max(1, (int)h));
+            }
+        } else if (opcion.rfind("--generaciones=", 0) == 0) {
+            opciones.generaciones = max(1, atoi(opcion.c_str() + 15));
+        } else if (opcion.rfind("--repeticiones=", 0) == 0) {
+            opciones.repeticiones = max(1, atoi(opcion.c_str() + 15));
+        } else if (opcion.rfind("--semilla=", 0) == 0) {
+            opciones.semilla = strtoull(opcion.c_str() + 10, nullptr, 10);
+        } else if (opcion.rfind("--densidades=", 0) == 0) {
+            vector<double> d = leer_lista(opcion.substr(13));
+            if (d.size() != 3 || d[0] + d[1] + d[2] > 1) {
+                cout << "Error: Se esperaban tres densidades (rocas,conejos,zorros) que sumen como mucho 1" << endl;
+                return false;
+            }
+            opciones.densidades.rocas = d[0];
+            opciones.densidades.conejos = d[1];
+            opciones.densidades.zorros = d[2];
+        } else if (opcion.rfind("--parametros=", 0) == 0) {
+            vector<double> p = leer_lista(opcion.substr(13));
+            if (p.size() != 3) {
+                cout << "Error: Se esperaban tres parametros (proc_conejos,proc_zorros,comida_zorros)" << endl;
+                return false;
+            }
+            opciones.params.gen_proc_conejos = (int)p[0];
+            opciones.params.gen_proc_zorros = (int)p[1];
+            opciones.params.gen_comida_zorros = (int)p[2];
+        } else {
+            cout << "Error: Opcion desconocida: " << opcion << endl;
+            return false;
+        }
+    }
+    if (opciones.hilos.empty()) {
+        int maximo = omp_get_max_threads();
+        for (int h = 1; h < maximo; h *= 2) {
+            opciones.hilos.push_back(h);
+        }
+        opciones.hilos.push_back(maximo);
+    }
+    return true;
+}
+
+// Segundos de la mejor repetición de "generaciones" generaciones del motor
+// elegido; la carga del mundo queda fuera de la medida
+double medir_motor(const OpcionesBanco &opciones, int filas, int columnas, int hilos) {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    int num_rocas;
+    omp_set_num_threads(hilos);
+    generar_mundo(filas, columnas, opciones.densidades, opciones.semilla, mundo, conejos, zorros, num_rocas);
+
+    Parametros params = opciones.params;
+    params.num_hilos = hilos;
+    params.num_generaciones = opciones.generaciones;
+    params.num_objetos = num_rocas + conejos.size() + zorros.size();
+
+    double mejor = 0;
+    for (int r = 0; r < opciones.repeticiones; r++) {
+        unique_ptr<Motor> motor = crear_motor(params);
+        motor->cargar(mundo, conejos, zorros);
+        double inicio = omp_get_wtime();
+        for (int gen = 0; gen < params.num_generaciones; gen++) {
+            motor->avanzar(params, gen);
+        }
+        motor->sincronizar();
+        double segundos = omp_get_wtime() - inicio;
+        if (r == 0 || segundos < mejor) {
+            mejor = segundos;
+        }
+    }
+    return mejor;
+}
+
+// Barrido de tamaño por hilos. Escalado fuerte: mismo mundo con más hilos,
+// eficiencia = T1 / (p * Tp). Escalado débil: las columnas crecen con los hilos
+// para mantener las celdas por hilo, eficiencia = T1 / Tp.
+void banco_escalado(const OpcionesBanco &opciones) {
+    cout << "escalado,motor,filas,columnas,hilos,generaciones,segundos,generaciones_por_segundo,celdas_por_segundo,eficiencia\n";
+    auto informar = [&](const char *tipo, int filas, int columnas, int hilos, double segundos, double eficiencia) {
+        double celdas = (double)filas * columnas * opciones.generaciones;
+        cout << tipo << "," << NOMBRES_MOTORES[opciones.params.motor] << "," << filas << "," << columnas << ","
+             << hilos << "," << opciones.generaciones << "," << segundos << ","
+             << opciones.generaciones / segundos << "," << celdas / segundos << "," << eficiencia << endl;
+    };
+
+    for (int tamano : opciones.tamanos) {
+        double base = 0;
+        for (int hilos : opciones.hilos) {
+            double segundos = medir_motor(opciones, tamano, tamano, hilos);
+            if (base == 0) {
+                base = segundos * opciones.hilos[0];
+            }
+            informar("fuerte", tamano, tamano, hilos, segundos, base / (hilos * segundos));
+        }
+    }
+    for (int tamano : opciones.tamanos) {
+        double base = 0;
+        for (int hilos : opciones.hilos) {
+            int columnas = tamano * hilos / opciones.hilos[0];
+            double segundos = medir_motor(opciones, tamano, columnas, hilos);
+            if (base == 0) {
+                base = segundos;
+            }
+            informar("debil", tamano, columnas, hilos, segundos, base / segundos);
+        }
+    }
+}
+
+// Microbancos de las piezas del motor original. Cada repetición parte del
+// mismo estado; solo se cronometra la función medida.
+void banco_micro(const OpcionesBanco &opciones) {
+    cout << "prueba,filas,columnas,hilos,repeticiones,segundos,ns_por_celda\n";
+    for (int tamano : opciones.tamanos) {
+        for (int hilos : opciones.hilos) {
+            omp_set_num_threads(hilos);
+            Mundo original;
+            vector<Conejo> conejos_originales;
+            vector<Zorro> zorros_originales;
+            int num_rocas;
+            generar_mundo(tamano, tamano, opciones.densidades, opciones.semilla, original,
+                          conejos_originales, zorros_originales, num_rocas);
+            Parametros params = opciones.params;
+            params.num_hilos = hilos;
+
+            Mundo mundo;
+            vector<Conejo> conejos;
+            vector<Zorro> zorros;
+            EstadoGeneracion estado;
+            estado.preparar(original);
+
+            double tiempos[4] = {0, 0, 0, 0};
+            long long suma = 0;  // Evita que el compilador descarte la búsqueda de vecinos
+            for (int r = 0; r < opciones.repeticiones; r++) {
+                mundo = original;
+                conejos = conejos_originales;
+                zorros = zorros_originales;
+
+                double t0 = omp_get_wtime();
+                #pragma omp parallel for reduction(+:suma)
+                for (int i = 0; i < tamano; i++) {
+                    for (int j = 0; j < tamano; j++) {
+                        suma += obtener_celdas_adyacentes(i, j, mundo, VACIO).cantidad;
+                    }
+                }
+                double t1 = omp_get_wtime();
+                estado.nueva_generacion(mundo);
+                double t2 = omp_get_wtime();
+                mover_conejos(mundo, conejos, params, r, estado);
+                double t3 = omp_get_wtime();
+                mover_zorros(mundo, zorros, conejos, params, r, estado);
+                double t4 = omp_get_wtime();
+                tiempos[0] += t1 - t0;
+                tiempos[1] += t2 - t1;
+                tiempos[2] += t3 - t2;
+                tiempos[3] += t4 - t3;
+            }
+
+            const char *nombres[4] = {"obtener_celdas_adyacentes", "nueva_generacion", "mover_conejos", "mover_zorros"};
+            double celdas = (double)tamano * tamano;
+            for (int p = 0; p < 4; p++) {
+                double segundos = tiempos[p] / opciones.repeticiones;
+                cout << nombres[p] << "," << tamano << "," << tamano << "," << hilos << ","
+                     << opciones.repeticiones << "," << segundos << "," << segundos * 1e9 / celdas << endl;
+            }
+            if (suma < 0) {
+                cout << suma << endl;
+            }
+        }
+    }
+}
+
+int main_banco(int argc, char* argv[]) {
+    OpcionesBanco opciones;
+    if (!leer_opciones_banco(argc, argv, opciones)) {
+        return 1;
+    }
+    if (opciones.modo == "micro") {
+        banco_micro(opciones);
+    } else {
+        banco_escalado(opciones);
+    }
+    return 0;
+}
+
+// Escribe un mundo generado en el formato de texto de entrada
+int generar_archivo(int argc, char* argv[]) {
+    int filas = atoi(argv[2]);
+    int columnas = atoi(argv[3]);
+    uint64_t semilla = strtoull(argv[4], nullptr, 10);
+    if (filas < 1 || columnas < 1) {
+        cout << "Error: Dimensiones invalidas" << endl;
+        return 1;
+    }
+    Densidades densidades;
+    if (argc == 7) {
+        vector<double> d = leer_lista(argv[6]);
+        if (d.size() != 3 || d[0] + d[1] + d[2] > 1) {
+            cout << "Error: Se esperaban tres densidades (rocas,conejos,zorros) que sumen como mucho 1" << endl;
+            return 1;
+        }
+        densidades.rocas = d[0];
+        densidades.conejos = d[1];
+        densidades.zorros = d[2];
+    }
+
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    int num_rocas;
+    generar_mundo(filas, columnas, densidades, semilla, mundo, conejos, zorros, num_rocas);
+    ofstream archivo_salida(argv[5]);
+    if (!archivo_salida.is_open()) {
+        cout << "Error: No se pudo abrir el archivo de salida: " << argv[5] << endl;
+        return 1;
+    }
+    Parametros params;
+    params.gen_proc_conejos = 3;
+    params.gen_proc_zorros = 8;
+    params.gen_comida_zorros = 5;
+    params.num_generaciones = 100;
+    escribir_texto(archivo_salida, mundo, params, params.num_generaciones, num_rocas + conejos.size() + zorros.size());
+    return 0;
+}
+
+// Verificación diferencial: en mundos y parámetros aleatorios (deterministas a
+// partir de la semilla) cada motor, con cada número de hilos, se compara con el
+// motor de referencia en todas las generaciones: las celdas y el estado de
+// todos los animales. Se informa la primera generación y celda que difiere.
+struct OpcionesVerificacion {
+    int casos = 50;
+    uint64_t semilla = 1;
+    int tamano_maximo = 48;
+    int generaciones_maximas = 40;
+    vector<int> hilos;
+    vector<int> motores;
+};
+
+bool leer_opciones_verificacion(int argc, char* argv[], OpcionesVerificacion &opciones) {
+    for (int i = 2; i < argc; i++) {
+        string opcion = argv[i];
+        if (opcion.rfind("--casos=", 0) == 0) {
+            opciones.casos = max(1, atoi(opcion.c_str() + 8));
+        } else if (opcion.rfind("--semilla=", 0) == 0) {
+            opciones.semilla = strtoull(opcion.c_str() + 10, nullptr, 10);
+        } else if (opcion.rfind("--tamano=", 0) == 0) {
+            opciones.tamano_maximo = max(1, atoi(opcion.c_str() + 9));
+        } else if (opcion.rfind("--generaciones=", 0) == 0) {
+            opciones.generaciones_maximas = max(1, atoi(opcion.c_str() + 15));
+        } else if (opcion.rfind("--hilos=", 0) == 0) {
+            for (double h : leer_lista(opcion.substr(8))) {
+                opciones.hilos.push_back(max(1, (int)h));
+            }
+        } else if (opcion.rfind("--motores=", 0) == 0) {
+            string nombres = opcion.substr(10);
+            size_t inicio = 0;
+            while (inicio <= nombres.size()) {
+                size_t fin = min(nombres.find(',', inicio), nombres.size());
+                int motor = buscar_motor(nombres.substr(inicio, fin - inicio));
+                if (motor == -1) {
+                    cout << "Error: Motor desconocido: " << nombres.substr(inicio, fin - inicio) << endl;
+                    return false;
+                }
+                opciones.motores.push_back(motor);
+                inicio = fin + 1;
+            }
+        } else {
+            cout << "Error: Opcion desconocida: " << opcion << endl;
+            return false;
+        }
+    }
+    if (opciones.hilos.empty()) {
+        opciones.hilos = {1, 2, 3, max(4, omp_get_max_threads())};
+    }
+    if (opciones.motores.empty()) {
+        for (int m = 0; m < NUM_MOTORES; m++) {
+            if (m != MOTOR_REFERENCIA) {
+                opciones.motores.push_back(m);
+            }
+        }
+    }
+    return true;
+}
+
+// Estado completo de una generación para comparar
+struct EstadoVerificado {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+};
+
+// Devuelve una descripción de la primera diferencia, o una cadena vacía
+string comparar_estados(const EstadoVerificado &esperado, const EstadoVerificado &obtenido) {
+    const char *nombres[4] = {"VACIO", "CONEJO", "ZORRO", "ROCA"};
+    for (int i = 0; i < esperado.mundo.filas; i++) {
+        for (int j = 0; j < esperado.mundo.columnas; j++) {
+            int a = esperado.mundo.matriz(i, j);
+            int b = obtenido.mundo.matriz(i, j);
+            if (a != b) {
+                return "celda (" + to_string(i) + ", " + to_string(j) + "): se esperaba " + nombres[a] + " y hay " + nombres[b];
+            }
+        }
+    }
+    if (esperado.conejos.size() != obtenido.conejos.size() || esperado.zorros.size() != obtenido.zorros.size()) {
+        return "poblaciones: se esperaban " + to_string(esperado.conejos.size()) + " conejos y " + to_string(esperado.zorros.size())
+               + " zorros, hay " + to_string(obtenido.conejos.size()) + " y " + to_string(obtenido.zorros.size());
+    }
+    for (size_t k = 0; k < esperado.conejos.size(); k++) {
+        const Conejo &a = esperado.conejos[k];
+        const Conejo &b = obtenido.conejos[k];
+        if (a.x != b.x || a.y != b.y || a.edad_reproduccion != b.edad_reproduccion) {
+            return "conejo en (" + to_string(a.x) + ", " + to_string(a.y) + "): edad esperada " + to_string(a.edad_reproduccion)
+                   + ", obtenido (" + to_string(b.x) + ", " + to_string(b.y) + ") con edad " + to_string(b.edad_reproduccion);
+        }
+    }
+    for (size_t k = 0; k < esperado.zorros.size(); k++) {
+        const Zorro &a = esperado.zorros[k];
+        const Zorro &b = obtenido.zorros[k];
+        if (a.x != b.x || a.y != b.y || a.edad_reproduccion != b.edad_reproduccion || a.hambre != b.hambre) {
+            return "zorro en (" + to_string(a.x) + ", " + to_string(a.y) + "): edad/hambre esperadas " + to_string(a.edad_reproduccion)
+                   + "/" + to_string(a.hambre) + ", obtenido (" + to_string(b.x) + ", " + to_string(b.y) + ") con "
+                   + to_string(b.edad_reproduccion) + "/" + to_string(b.hambre);
+        }
+    }
+    return "";
+}
+
+int main_verificacion(int argc, char* argv[]) {
+    OpcionesVerificacion opciones;
+    if (!leer_opciones_verificacion(argc, argv, opciones)) {
+        return 1;
+    }
+
+    int fallos = 0;
+    for (int caso = 0; caso < opciones.casos; caso++) {
+        // Todo lo aleatorio del caso sale de la semilla y su número
+        uint64_t azar = mezclar(opciones.semilla * 1000003 + caso);
+        auto sacar = [&](int minimo, int maximo) {
+            azar = mezclar(azar);
+            return minimo + (int)(azar % (uint64_t)(maximo - minimo + 1));
+        };
+        int filas = sacar(1, opciones.tamano_maximo);
+        int columnas = sacar(1, opciones.tamano_maximo);
+        Densidades densidades;
+        densidades.rocas = sacar(0, 20) / 100.0;
+        densidades.conejos = sacar(0, 60) / 100.0;
+        densidades.zorros = sacar(0, 20) / 100.0;
+        Parametros params;
+        params.gen_proc_conejos = sacar(0, 8);
+        params.gen_proc_zorros = sacar(0, 12);
+        params.gen_comida_zorros = sacar(0, 10);
+        params.num_generaciones = sacar(1, opciones.generaciones_maximas);
+        params.num_procesos = sacar(1, 4);
+        // Una de cada cuatro veces Moore y una de cada cuatro toroidal; el
+        // toroidal necesita al menos 3 filas y 3 columnas
+        params.vecindad = sacar(0, 3) == 0 ? VECINDAD_MOORE : VECINDAD_VON_NEUMANN;
+        params.contorno = sacar(0, 3) == 0 && filas >= 3 && columnas >= 3 ? CONTORNO_TOROIDAL : CONTORNO_ACOTADO;
+        uint64_t semilla_mundo = azar;
+
+        EstadoVerificado inicial;
+        int num_rocas;
+        generar_mundo(filas, columnas, densidades, semilla_mundo, inicial.mundo, inicial.conejos, inicial.zorros, num_rocas);
+        params.num_objetos = num_rocas + inicial.conejos.size() + inicial.zorros.size();
+
+        // Trayectoria de referencia
+        vector<EstadoVerificado> referencia(params.num_generaciones);
+        MotorReferencia motor_referencia;
+        motor_referencia.cargar(inicial.mundo, inicial.conejos, inicial.zorros);
+        for (int gen = 0; gen < params.num_generaciones; gen++) {
+            motor_referencia.avanzar(params, gen);
+            motor_referencia.exportar(referencia[gen].mundo, referencia[gen].conejos, referencia[gen].zorros);
+        }
+
+        cout << "Caso " << caso << ": " << filas << "x" << columnas << ", " << params.num_objetos << " objetos, parametros "
+             << params.gen_proc_conejos << " " << params.gen_proc_zorros << " " << params.gen_comida_zorros
+             << ", " << params.num_generaciones << " generaciones";
+        if (params.vecindad != VECINDAD_VON_NEUMANN || params.contorno != CONTORNO_ACOTADO) {
+            cout << ", " << NOMBRES_VECINDADES[params.vecindad] << " " << NOMBRES_CONTORNOS[params.contorno];
+        }
+        bool caso_correcto = true;
+        for (int motor_elegido : opciones.motores) {
+            // Los demás motores solo tienen la vecindad y el contorno originales
+            if (!admite_vecindad(params.vecindad, params.contorno, motor_elegido)) {
+                continue;
+            }
+            for (int hilos : opciones.hilos) {
+                omp_set_num_threads(hilos);
+                params.motor = motor_elegido;
+                params.num_hilos = hilos;
+                unique_ptr<Motor> motor = crear_motor(params);
+                motor->cargar(inicial.mundo, inicial.conejos, inicial.zorros);
+                EstadoVerificado obtenido;
+                for (int gen = 0; gen < params.num_generaciones; gen++) {
+                    motor->avanzar(params, gen);
+                    motor->exportar(obtenido.mundo, obtenido.conejos, obtenido.zorros);
+                    string diferencia = comparar_estados(referencia[gen], obtenido);
+                    if (!diferencia.empty()) {
+                        if (caso_correcto) {
+                            cout << "\n";
+                        }
+                        cout << "  DIVERGE motor " << NOMBRES_MOTORES[motor_elegido] << ", " << hilos << " hilos";
+                        if (motor_elegido == MOTOR_DISTRIBUIDO) {
+                            cout << ", " << params.num_procesos << " procesos";
+                        }
+                        cout << ", semilla del mundo " << semilla_mundo << ", tras la generacion " << gen << ": " << diferencia << "\n";
+                        caso_correcto = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (caso_correcto) {
+            cout << ": OK\n";
+        } else {
+            fallos++;
+        }
+    }
+
+    cout << (opciones.casos - fallos) << " de " << opciones.casos << " casos coinciden con la referencia" << endl;
+    return fallos == 0 ? 0 : 1;
+}
+
+inline char simbolo_celda(uint8_t estado) {
+    switch (estado) {
+        case VACIO: return '.';
+        case CONEJO: return 'R';
+        case ZORRO: return 'F';
+        case ROCA: return '*';
+        default: return '?';
+    }
+}
+
+// Compone el dibujo del mundo en un búfer para escribirlo de una vez
+void componer_mundo(string &salida, const Mundo &mundo, int generacion) {
+    string borde(mundo.columnas * 2 + 1, '-');
+    salida += "Generacion " + to_string(generacion) + "\n" + borde + "\n";
+    for (int i = 0; i < mundo.filas; i++) {
+        salida += '|';
+        const uint8_t *fila = mundo.matriz.fila(i);
+        for (int j = 0; j < mundo.columnas; j++) {
+            salida += simbolo_celda(fila[j]);
+            salida += ' ';
+        }
+        salida += "\b|\n";
+    }
+    salida += borde + "\n\n";
+}
+
+void imprimir_mundo(const Mundo &mundo, int generacion) {
+    string salida;
+    componer_mundo(salida, mundo, generacion);
+    cout << salida << flush;
+}
+
+// Dibujo incremental para el modo interactivo. Guarda lo que hay en pantalla y
+// en cada cuadro solo manda, con secuencias ANSI de posición del cursor, las
+// celdas que cambiaron; todo el cuadro sale en una sola escritura. Si el mundo
+// no cabe en la terminal se redibuja entero, porque el desplazamiento de la
+// pantalla invalidaría las posiciones.
+class RenderizadorTerminal {
+public:
+    // Deja el cursor debajo del mundo con el resto de la pantalla limpio, para
+    // que las estadísticas y los mensajes se escriban a continuación
+    void dibujar(const Mundo &mundo, int generacion) {
+        salida.clear();
+        size_t celdas = (size_t)mundo.filas * mundo.columnas;
+        if (!cabe(mundo)) {
+            // El dibujo desplaza la pantalla: el siguiente no puede ser incremental
+            salida += "\x1b[H\x1b[2J\x1b[3J";
+            componer_mundo(salida, mundo, generacion);
+            mostrado.clear();
+        } else if (mostrado.size() != celdas) {
+            salida += "\x1b[H\x1b[2J\x1b[3J";
+            componer_mundo(salida, mundo, generacion);
+            mostrado.resize(celdas);
+            for (int i = 0; i < mundo.filas; i++) {
+                copy(mundo.matriz.fila(i), mundo.matriz.fila(i) + mundo.columnas, &mostrado[(size_t)i * mundo.columnas]);
+            }
+        } else {
+            salida += "\x1b[H";
+            salida += "Generacion " + to_string(generacion) + "\x1b[K";
+            for (int i = 0; i < mundo.filas; i++) {
+                const uint8_t *fila = mundo.matriz.fila(i);
+                uint8_t *anterior = &mostrado[(size_t)i * mundo.columnas];
+                int siguiente = -1;  // Columna en la que quedó el cursor tras la última celda
+                for (int j = 0; j < mundo.columnas; j++) {
+                    if (fila[j] == anterior[j]) {
+                        continue;
+                    }
+                    anterior[j] = fila[j];
+                    if (j == siguiente) {
+                        // La celda de al lado: basta con pasar el espacio
+                        salida += ' ';
+                    } else {
+                        // Fila i en la línea i + 3 de la pantalla, celda j en la columna 2j + 2
+                        salida += "\x1b[" + to_string(i + 3) + ";" + to_string(2 * j + 2) + "H";
+                    }
+                    salida += simbolo_celda(fila[j]);
+                    siguiente = j + 1;
+                }
+            }
+            salida += "\x1b[" + to_string(mundo.filas + 5) + ";1H";
+        }
+        salida += "\x1b[J";
+
+        cout << flush;
+        size_t escritos = 0;
+        while (escritos < salida.size()) {
+            ssize_t n = write(STDOUT_FILENO, salida.data() + escritos, salida.size() - escritos);
+            if (n <= 0) {
+                break;
+            }
+            escritos += n;
+        }
+    }
+
+    // Tras limpiar la pantalla o escribir debajo del dibujo sin límite (la
+    // pantalla puede haberse desplazado) hay que volver a dibujar todo
+    void invalidar() {
+        mostrado.clear();
+    }
+
+private:
+    string salida;
+    vector<uint8_t> mostrado;
+
+    // El mundo, las estadísticas y la línea de estado caben sin desplazar la pantalla
+    static bool cabe(const Mundo &mundo) {
+        winsize tamano;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &tamano) == -1) {
+            return false;
+        }
+        return mundo.filas + 14 <= tamano.ws_row && mundo.columnas * 2 + 1 <= tamano.ws_col;
+    }
+};
+
+void imprimir_estadisticas(int generacion, size_t num_conejos, size_t num_zorros) {
+    cout << "Generacion " << generacion << ":\n";
+    cout << " - Conejos: " << num_conejos << "\n";
+    cout << " - Zorros : " << num_zorros << "\n";
+    cout << "-------------------------" << endl;
+}
+
+void imprimir_estadisticas(int generacion, const vector<Conejo> &conejos, const vector<Zorro> &zorros) {
+    imprimir_estadisticas(generacion, conejos.size(), zorros.size());
+}
+
+// Trayectoria: flujo binario con el estado del mundo cada N generaciones.
+//   Cabecera: "ECOTRAY1", filas, columnas y cada (int32)
+//   Cada cuadro: generación (int32), conejos y zorros (uint64), número de
+//   cambios y bytes codificados (uint64), y los cambios respecto al cuadro
+//   anterior: por cada celda que cambió, la distancia desde la anterior celda
+//   cambiada menos uno en varint y el nuevo estado en un byte. El primer cuadro
+//   se compara con un mundo vacío.
+const char MAGIA_TRAYECTORIA[8] = {'E', 'C', 'O', 'T', 'R', 'A', 'Y', '1'};
+
+struct CuadroTrayectoria {
+    int generacion;
+    uint64_t num_conejos;
+    uint64_t num_zorros;
+    vector<uint8_t> celdas;  // filas * columnas, sin borde
+};
+
+// Graba la trayectoria sin frenar la simulación: el hilo de la simulación solo
+// copia la matriz en una ranura libre de un anillo acotado y un hilo de E/S
+// calcula las diferencias, las codifica y las escribe. La simulación solo espera
+// si el disco va más de NUM_RANURAS cuadros por detrás.
+class GrabadorTrayectoria {
+public:
+    static const int NUM_RANURAS = 4;
+
+    bool abrir(const string &ruta, int filas, int columnas, int cada) {
+        archivo.open(ruta, ios::binary | ios::trunc);
+        if (!archivo.is_open()) {
+            return false;
+        }
+        this->filas = filas;
+        this->columnas = columnas;
+        this->cada = cada;
+        archivo.write(MAGIA_TRAYECTORIA, sizeof(MAGIA_TRAYECTORIA));
+        int32_t cabecera[3] = {filas, columnas, cada};
+        archivo.write(reinterpret_cast<const char *>(cabecera), sizeof(cabecera));
+
+        size_t celdas = (size_t)filas * columnas;
+        for (CuadroTrayectoria &ranura : ranuras) {
+            ranura.celdas.resize(celdas);
+        }
+        anterior.assign(celdas, VACIO);
+        escritor = thread(&GrabadorTrayectoria::escribir, this);
+        return true;
+    }
+
+    ~GrabadorTrayectoria() {
+        cerrar();
+    }
+
+    // Se graban la generación 0 (estado inicial), cada múltiplo de "cada" y la última
+    bool toca(int generacion, int ultima) const {
+        return archivo.is_open() && (generacion % cada == 0 || generacion == ultima);
+    }
+
+    void registrar(const Mundo &mundo, int generacion, uint64_t num_conejos, uint64_t num_zorros) {
+        llenar_ranura(generacion, [&](CuadroTrayectoria &ranura) {
+            ranura.num_conejos = num_conejos;
+            ranura.num_zorros = num_zorros;
+            copiar_filas(mundo.matriz, ranura.celdas.data());
+        });
+    }
+
+    // El motor copia su matriz directamente en la ranura: una sola copia del
+    // mundo por cuadro
+    void registrar(Motor &motor, int generacion) {
+        llenar_ranura(generacion, [&](CuadroTrayectoria &ranura) {
+            size_t num_conejos;
+            size_t num_zorros;
+            motor.copiar_celdas(ranura.celdas.data(), num_conejos, num_zorros);
+            ranura.num_conejos = num_conejos;
+            ranura.num_zorros = num_zorros;
+        });
+    }
+
+    // Devuelve false si alguna escritura falló (por ejemplo, disco lleno) y la
+    // trayectoria quedó incompleta
+    bool cerrar() {
+        if (!escritor.joinable()) {
+            return correcto;
+        }
+        {
+            lock_guard<mutex> cerrojo(guarda);
+            terminado = true;
+        }
+        hay_cuadro.notify_one();
+        escritor.join();
+        archivo.close();
+        correcto = correcto && !archivo.fail();
+        return correcto;
+    }
+
+private:
+    ofstream archivo;
+    int filas = 0;
+    int columnas = 0;
+    int cada = 1;
+    CuadroTrayectoria ranuras[NUM_RANURAS];
+    int primera = 0;   // Ranura más antigua pendiente de escribir
+    int llenas = 0;
+    bool terminado = false;
+    mutex guarda;
+    condition_variable hay_hueco;
+    condition_variable hay_cuadro;
+    thread escritor;
+    vector<uint8_t> anterior;   // Último cuadro escrito
+    vector<uint8_t> codificado;
+    bool correcto = true;       // El flujo no ha fallado al escribir
+
+    template <typename Llenar>
+    void llenar_ranura(int generacion, Llenar llenar) {
+        unique_lock<mutex> cerrojo(guarda);
+        hay_hueco.wait(cerrojo, [&]() { return llenas < NUM_RANURAS; });
+        CuadroTrayectoria &ranura = ranuras[(primera + llenas) % NUM_RANURAS];
+        cerrojo.unlock();
+
+        ranura.generacion = generacion;
+        llenar(ranura);
+
+        cerrojo.lock();
+        llenas++;
+        hay_cuadro.notify_one();
+    }
+
+    void escribir() {
+        while (true) {
+            unique_lock<mutex> cerrojo(guarda);
+            hay_cuadro.wait(cerrojo, [&]() { return llenas > 0 || terminado; });
+            if (llenas == 0) {
+                return;
+            }
+            CuadroTrayectoria &ranura = ranuras[primera];
+            cerrojo.unlock();
+
+            // Codificar los cambios y quedarse con este cuadro como el anterior
+            codificado.clear();
+            uint64_t num_cambios = 0;
+            uint64_t ultima = (uint64_t)-1;
+            const size_t total = ranura.celdas.size();
+            for (size_t k = 0; k < total; k++) {
+                // Saltar de ocho en ocho los tramos sin cambios
+                if ((k & 7) == 0) {
+                    uint64_t actual_8, anterior_8;
+                    while (k + 8 <= total) {
+                        memcpy(&actual_8, &ranura.celdas[k], 8);
+                        memcpy(&anterior_8, &anterior[k], 8);
+                        if (actual_8 != anterior_8) {
+                            break;
+                        }
+                        k += 8;
+                    }
+                    if (k >= total) {
+                        break;
+                    }
+                }
+                if (ranura.celdas[k] != anterior[k]) {
+                    uint64_t salto = k - ultima - 1;
+                    while (salto >= 0x80) {
+                        codificado.push_back((uint8_t)(salto | 0x80));
+                        salto >>= 7;
+                    }
+                    codificado.push_back((uint8_t)salto);
+                    codificado.push_back(ranura.celdas[k]);
+                    ultima = k;
+                    num_cambios++;
+                }
+            }
+            anterior.swap(ranura.celdas);
+
+            int32_t generacion = ranura.generacion;
+            uint64_t datos[4] = {ranura.num_conejos, ranura.num_zorros, num_cambios, codificado.size()};
+            archivo.write(reinterpret_cast<const char *>(&generacion), sizeof(generacion));
+            archivo.write(reinterpret_cast<const char *>(datos), sizeof(datos));
+            archivo.write(reinterpret_cast<const char *>(codificado.data()), codificado.size());
+            // Lo que quede se sigue consumiendo para no bloquear la simulación
+            correcto = correcto && archivo.good();
+
+            cerrojo.lock();
+            primera = (primera + 1) % NUM_RANURAS;
+            llenas--;
+            hay_hueco.notify_one();
+        }
+    }
+};
+
+// Reproduce una trayectoria: reconstruye cada cuadro aplicando sus cambios y
+// muestra las poblaciones y, si se pide, el mundo
+int reproducir_trayectoria(const string &ruta, bool mostrar) {
+    ifstream archivo(ruta, ios::binary);
+    char magia[8];
+    int32_t cabecera[3];
+    if (!archivo.read(magia, sizeof(magia)) || !equal(magia, magia + 8, MAGIA_TRAYECTORIA)
+        || !archivo.read(reinterpret_cast<char *>(cabecera), sizeof(cabecera)) || cabecera[0] < 1 || cabecera[1] < 1) {
+        cout << "Error: No es una trayectoria: " << ruta << endl;
+        return 1;
+    }
+    streamoff inicio_cuadros = archivo.tellg();
+    archivo.seekg(0, ios::end);
+    uint64_t tamano = archivo.tellg();
+    archivo.seekg(inicio_cuadros);
+
+    Mundo mundo;
+    mundo.filas = cabecera[0];
+    mundo.columnas = cabecera[1];
+    mundo.matriz.redimensionar(mundo.filas, mundo.columnas, VACIO, ROCA);
+    cout << "Trayectoria de " << mundo.filas << "x" << mundo.columnas << ", cada " << cabecera[2] << " generaciones\n";
+
+    vector<uint8_t> codificado;
+    int32_t generacion;
+    uint64_t num_celdas = (uint64_t)mundo.filas * mundo.columnas;
+    while (archivo.read(reinterpret_cast<char *>(&generacion), sizeof(generacion))) {
+        // Nada del cuadro se usa sin comprobar: un archivo cortado o dañado se
+        // rechaza en vez de escribir fuera del mundo
+        uint64_t datos[4];
+        if (!archivo.read(reinterpret_cast<char *>(datos), sizeof(datos))
+            || datos[3] > tamano - (uint64_t)archivo.tellg()) {
+            cout << "Error: Trayectoria truncada en la generacion " << generacion << endl;
+            return 1;
+        }
+        codificado.resize(datos[3]);
+        if (!archivo.read(reinterpret_cast<char *>(codificado.data()), codificado.size())) {
+            cout << "Error: Trayectoria truncada en la generacion " << generacion << endl;
+            return 1;
+        }
+
+        uint64_t celda = (uint64_t)-1;
+        size_t p = 0;
+        bool valido = datos[2] <= num_celdas;
+        for (uint64_t c = 0; c < datos[2] && valido; c++) {
+            uint64_t salto = 0;
+            int desplazamiento = 0;
+            while (p < codificado.size() && (codificado[p] & 0x80) && desplazamiento < 63) {
+                salto |= (uint64_t)(codificado[p++] & 0x7f) << desplazamiento;
+                desplazamiento += 7;
+            }
+            // Falta el último byte del salto o el estado, o el salto no cabe en 64 bits
+            if (p + 2 > codificado.size() || desplazamiento >= 63) {
+                valido = false;
+                break;
+            }
+            salto |= (uint64_t)codificado[p++] << desplazamiento;
+            uint8_t estado = codificado[p++];
+            valido = salto < num_celdas - (celda + 1) && estado <= ROCA;
+            if (valido) {
+                celda += salto + 1;
+                mundo.matriz(celda / mundo.columnas, celda % mundo.columnas) = estado;
+            }
+        }
+        if (!valido || p != codificado.size()) {
+            cout << "Error: Trayectoria no valida en la generacion " << generacion << endl;
+            return 1;
+        }
+
+        if (mostrar) {
+            imprimir_mundo(mundo, generacion);
+        }
+        cout << "Generacion " << generacion << ": conejos " << datos[0] << ", zorros " << datos[1]
+             << ", celdas cambiadas " << datos[2] << "\n";
+    }
+    return 0;
+}
+
+void mostrar_controles() {
+    cout << "\n--- CONTROLES ---\n";
+    cout << "p: Pausar/Reanudar\n";
+    cout << "+: Aumentar velocidad\n";
+    cout << "-: Disminuir velocidad\n";
+    cout << "q: Acabar la simulacion\n";
+    cout << "----------------\n";
+}
+
+
+// Función para configurar la terminal para lectura sin bloqueo
+void configurar_terminal(struct termios &old_settings) {
+    struct termios new_settings;
+    tcgetattr(0, &old_settings);            // Guarda configuración actual del teclado
+    new_settings = old_settings;            // Crea una copia para modificar
+    new_settings.c_lflag &= ~ICANON;        // Desactiva modo canónico (no esperar ENTER)
+    new_settings.c_lflag &= ~ECHO;          // Desactiva eco (no mostrar lo que escribes)
+    new_settings.c_cc[VMIN] = 0;            // No requiere número mínimo de caracteres
+    new_settings.c_cc[VTIME] = 0;           // Sin tiempo de espera
+    tcsetattr(0, TCSANOW, &new_settings);   // Aplica los nuevos ajustes inmediatamente
+    fcntl(0, F_SETFL, O_NONBLOCK);          // Establece entrada estándar (0) como no bloqueante
+}
+
+
+// Restaura la configuración original de la terminal
+void restaurar_terminal(const struct termios &old_settings) {
+    tcsetattr(0, TCSANOW, &old_settings);  // Restaura los ajustes originales del teclado
+    fcntl(0, F_SETFL, 0);                  // Vuelve al modo bloqueante por defecto
+}
+
+char procesar_input() {
+    char c;
+    if (read(0, &c, 1) < 1) {
+        return 0;  // No se presionó ninguna tecla
+    }
+    return c;     // Retorna el carácter presionado
+}
+
+// Lee las opciones que siguen a los archivos de entrada y salida
+bool leer_opciones(int argc, char* argv[], Parametros &params, Opciones &opciones, ostream &errores = cout) {
+    for (int i = 3; i < argc; i++) {
+        string opcion = argv[i];
+        if (opcion.rfind("--motor=", 0) == 0) {
+            string nombre = opcion.substr(8);
+            int encontrado = buscar_motor(nombre);
+            if (encontrado == -1) {
+                errores << "Error: Motor desconocido: " << nombre << endl;
+                return false;
+            }
+            params.motor = encontrado;
+        } else if (opcion.rfind("--procesos=", 0) == 0) {
+            params.num_procesos = atoi(opcion.c_str() + 11);
+            if (params.num_procesos < 1) {
+                errores << "Error: Numero de procesos invalido: " << opcion << endl;
+                return false;
+            }
+        } else if (opcion.rfind("--trayectoria=", 0) == 0) {
+            opciones.trayectoria = opcion.substr(14);
+        } else if (opcion.rfind("--puntos-control=", 0) == 0) {
+            opciones.puntos_control = opcion.substr(17);
+        } else if (opcion.rfind("--cada-control=", 0) == 0) {
+            opciones.cada_control = atoi(opcion.c_str() + 15);
+            if (opciones.cada_control < 1) {
+                errores << "Error: Intervalo de puntos de control invalido: " << opcion << endl;
+                return false;
+            }
+        } else if (opcion.rfind("--parametros=", 0) == 0) {
+            vector<double> p = leer_lista(opcion.substr(13));
+            if (p.size() != 4 || p[0] < 1 || p[1] < 0 || p[2] < 1 || p[3] < 0) {
+                errores << "Error: Se esperaban cuatro parametros (proc_conejos,proc_zorros,comida_zorros,generaciones)" << endl;
+                return false;
+            }
+            params.gen_proc_conejos = (int)p[0];
+            params.gen_proc_zorros = (int)p[1];
+            params.gen_comida_zorros = (int)p[2];
+            params.num_generaciones = (int)p[3];
+            opciones.parametros = true;
+        } else if (opcion == "--modo=controles" || opcion == "--modo=inmediato") {
+            opciones.modo = opcion == "--modo=controles" ? 1 : 2;
+        } else if (opcion == "--formato=texto" || opcion == "--formato=binario") {
+            opciones.salida_binaria = opcion == "--formato=binario";
+        } else if (opcion == "--silencioso") {
+            opciones.silencioso = true;
+        } else if (opcion.rfind("--medidas=", 0) == 0) {
+#ifdef INSTRUMENTACION
+            opciones.medidas = opcion.substr(10);
+            if (omp_get_max_threads() > MAX_HILOS_MEDIDOS) {
+                errores << "Error: --medidas admite como mucho " << MAX_HILOS_MEDIDOS << " hilos" << endl;
+                return false;
+            }
+#else
+            errores << "Error: --medidas necesita compilar con -DINSTRUMENTACION" << endl;
+            return false;
+#endif
+        } else if (opcion == "--vecindad=von-neumann" || opcion == "--vecindad=moore") {
+            params.vecindad = opcion == "--vecindad=moore" ? VECINDAD_MOORE : VECINDAD_VON_NEUMANN;
+        } else if (opcion == "--contorno=acotado" || opcion == "--contorno=toroidal") {
+            params.contorno = opcion == "--contorno=toroidal" ? CONTORNO_TOROIDAL : CONTORNO_ACOTADO;
+        } else if (opcion.rfind("--cada=", 0) == 0) {
+            opciones.cada = atoi(opcion.c_str() + 7);
+            if (opciones.cada < 1) {
+                errores << "Error: Intervalo de trayectoria invalido: " << opcion << endl;
+                return false;
+            }
+        } else {
+            errores << "Error: Opcion desconocida: " << opcion << endl;
+            return false;
+        }
+    }
+    if (!admite_vecindad(params.vecindad, params.contorno, params.motor)) {
+        errores << "Error: La vecindad " << NOMBRES_VECINDADES[params.vecindad] << " con contorno "
+             << NOMBRES_CONTORNOS[params.contorno] << " solo la admiten los motores entidades y referencia" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Comprobaciones que dependen del mundo o de los parámetros definitivos, tras
+// leer la entrada. Devuelve un mensaje de error o una cadena vacía.
+//  - Con menos de 3 filas o columnas los vecinos del contorno toroidal se
+//    repiten (arriba y abajo son la misma celda, o la propia) y contarían dos
+//    veces al elegir destino.
+//  - El motor compacto guarda la edad en 15 bits y el hambre en 16: con
+//    parámetros mayores sus resultados se separarían de los demás motores.
+string validar_parametros(const Parametros &params, const Mundo &mundo) {
+    if (params.contorno == CONTORNO_TOROIDAL && (mundo.filas < 3 || mundo.columnas < 3)) {
+        return "El contorno toroidal necesita al menos 3 filas y 3 columnas, el mundo es de "
+               + to_string(mundo.filas) + "x" + to_string(mundo.columnas);
+    }
+    if (params.motor == MOTOR_COMPACTO && (params.gen_proc_conejos > (int)EDAD_MAXIMA_COMPACTA
+        || params.gen_proc_zorros > (int)EDAD_MAXIMA_COMPACTA || params.gen_comida_zorros > (int)HAMBRE_MAXIMA_COMPACTA)) {
+        return "El motor compacto admite generaciones de reproduccion hasta " + to_string(EDAD_MAXIMA_COMPACTA)
+               + " y de hambre hasta " + to_string(HAMBRE_MAXIMA_COMPACTA);
+    }
+    return "";
+}
+
+// Lee el mundo de entrada en texto o en el formato de instantánea. Devuelve un
+// mensaje de error, o una cadena vacía si todo fue bien.
+string cargar_entrada(const string &ruta, Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros,
+                      Parametros &params, int &num_rocas, int &generacion_inicial) {
+    if (es_instantanea(ruta)) {
+        VistaInstantanea vista;
+        string error = vista.abrir(ruta);
+        if (!error.empty()) {
+            return error;
+        }
+        return cargar_instantanea(vista, mundo, conejos, zorros, params, num_rocas, generacion_inicial);
+    }
+    if (!inicializar_mundo_mmap(ruta, mundo, conejos, zorros, params, num_rocas)) {
+        ifstream archivo_entrada(ruta);
+        if (!archivo_entrada.is_open()) {
+            return "No se pudo abrir el archivo de entrada: " + ruta;
+        }
+        inicializar_mundo(archivo_entrada, mundo, conejos, zorros, params, num_rocas);
+    }
+    return "";
+}
+
+// Simulación sin controles: avanza el motor hasta la última generación con la
+// trayectoria y los puntos de control pedidos y deja el estado final exportado
+void ejecutar_lote(Motor &motor, Mundo &mundo, vector<Conejo> &conejos, vector<Zorro> &zorros, const Parametros &params,
+                   int generacion_inicial, int num_rocas, GrabadorTrayectoria &grabador, PuntosControl &puntos_control) {
+    for (int gen = generacion_inicial; gen < params.num_generaciones; gen++) {
+        INICIAR_FASE(FASE_GENERACION);
+        motor.avanzar(params, gen);
+        SINCRONIZAR(motor);
+        TERMINAR_FASE(FASE_GENERACION);
+        if (puntos_control.toca(gen + 1)) {
+            motor.exportar(mundo, conejos, zorros);
+            puntos_control.guardar(mundo, conejos, zorros, params, gen + 1, num_rocas);
+        }
+        if (grabador.toca(gen + 1, params.num_generaciones)) {
+            grabador.registrar(motor, gen + 1);
+        }
+    }
+    motor.exportar(mundo, conejos, zorros);
+}
+
+// Lista de objetos leída con operator>>, para los archivos de texto que
+// leer_objetos_mmap no acepta
+bool leer_objetos_flujo(const string &ruta, int cabecera[7], vector<vector<ObjetoTexto>> &objetos) {
+    ifstream archivo_entrada(ruta);
+    if (!archivo_entrada.is_open()) {
+        return false;
+    }
+    for (int k = 0; k < 7; k++) {
+        archivo_entrada >> cabecera[k];
+    }
+    objetos.assign(1, vector<ObjetoTexto>());
+    for (int i = 0; i < cabecera[6]; i++) {
+        string tipo_objeto;
+        ObjetoTexto objeto;
+        archivo_entrada >> tipo_objeto >> objeto.x >> objeto.y;
+        objeto.tipo = tipo_objeto == "ROCK" ? ROCA : tipo_objeto == "RABBIT" ? CONEJO : tipo_objeto == "FOX" ? ZORRO : VACIO;
+        objetos[0].push_back(objeto);
+    }
+    return true;
+}
+
+// Respuesta inmediata sin el mundo denso, con los motores que cargan la lista
+// de objetos y escriben la salida desde su propio estado: el disperso (la
+// memoria depende de la población y no del área) y el de planos de bits (3
+// bits por celda en vez de un byte). Solo el dibujo final en consola necesita
+// el mundo denso.
+template <typename MotorObjetos>
+int ejecutar_sin_mundo(const string &ruta, ofstream &archivo_salida, Parametros &params, const Opciones &opciones) {
+    int cabecera[7];
+    vector<vector<ObjetoTexto>> objetos;
+    if (!leer_objetos_mmap(ruta, cabecera, objetos) && !leer_objetos_flujo(ruta, cabecera, objetos)) {
+        cout << "Error: No se pudo abrir el archivo de entrada: " << ruta << endl;
+        return 1;
+    }
+    aplicar_cabecera(cabecera, params);
+    MotorObjetos motor;
+    motor.cargar_objetos(cabecera[4], cabecera[5], objetos, params.num_objetos);
+    vector<vector<ObjetoTexto>>().swap(objetos);
+
+    auto inicio = chrono::high_resolution_clock::now();
+    for (int gen = 0; gen < params.num_generaciones; gen++) {
+        motor.avanzar(params, gen);
+    }
+
+    if (!opciones.silencioso) {
+        Mundo mundo;
+        vector<Conejo> conejos;
+        vector<Zorro> zorros;
+        motor.exportar(mundo, conejos, zorros);
+        imprimir_mundo(mundo, params.num_generaciones);
+    }
+    size_t num_conejos, num_zorros, num_rocas;
+    motor.poblaciones(num_conejos, num_zorros, num_rocas);
+    imprimir_estadisticas(params.num_generaciones, num_conejos, num_zorros);
+    motor.escribir_texto(archivo_salida, params, 0);
+
+    auto fin = chrono::high_resolution_clock::now();
+    chrono::duration<double> duracion = fin - inicio;
+    cout << "Tiempo de ejecucion: " << duracion.count() << " segundos" << endl;
+    return 0;
+}
+
+// Modo de especies: el mundo de texto usa los nombres del archivo de especies
+// en vez de RABBIT y FOX. Las generaciones salen de la cabecera, o de
+// --generaciones=N; los tres primeros campos se copian tal cual a la salida.
+int main_especies(int argc, char* argv[]) {
+    vector<Especie> especies;
+    string error = leer_especies(argv[2], especies);
+    if (!error.empty()) {
+        cout << "Error: " << error << endl;
+        return 1;
+    }
+    int num_generaciones = -1;
+    bool silencioso = false;
+    for (int i = 5; i < argc; i++) {
+        string opcion = argv[i];
+        if (opcion.rfind("--generaciones=", 0) == 0 && atoi(opcion.c_str() + 15) >= 0) {
+            num_generaciones = atoi(opcion.c_str() + 15);
+        } else if (opcion == "--silencioso") {
+            silencioso = true;
+        } else {
+            cout << "Error: Opcion no valida: " << opcion << endl;
+            return 1;
+        }
+    }
+
+    ifstream archivo_entrada(argv[3]);
+    if (!archivo_entrada.is_open()) {
+        cout << "Error: No se pudo abrir el archivo de entrada: " << argv[3] << endl;
+        return 1;
+    }
+    int cabecera[7];
+    for (int k = 0; k < 7; k++) {
+        archivo_entrada >> cabecera[k];
+    }
+    if (!archivo_entrada || cabecera[4] < 1 || cabecera[5] < 1) {
+        cout << "Error: Cabecera no valida en " << argv[3] << endl;
+        return 1;
+    }
+    if (num_generaciones < 0) {
+        num_generaciones = cabecera[3];
+    }
+    Mundo mundo;
+    mundo.filas = cabecera[4];
+    mundo.columnas = cabecera[5];
+    mundo.matriz.redimensionar(mundo.filas, mundo.columnas, VACIO, ROCA);
+    int num_rocas = 0;
+    for (int i = 0; i < cabecera[6]; i++) {
+        string tipo_objeto;
+        int x, y;
+        archivo_entrada >> tipo_objeto >> x >> y;
+        if (!archivo_entrada || x < 0 || x >= mundo.filas || y < 0 || y >= mundo.columnas) {
+            cout << "Error: Objeto " << i + 1 << " no valido en " << argv[3] << endl;
+            return 1;
+        }
+        if (tipo_objeto == "ROCK") {
+            mundo.matriz(x, y) = ROCA;
+            num_rocas++;
+            continue;
+        }
+        size_t s = 0;
+        while (s < especies.size() && especies[s].nombre != tipo_objeto) {
+            s++;
+        }
+        if (s == especies.size()) {
+            cout << "Error: Especie desconocida en " << argv[3] << ": " << tipo_objeto << endl;
+            return 1;
+        }
+        mundo.matriz(x, y) = estado_de_especie(s);
+    }
+
+    ofstream archivo_salida(argv[4]);
+    if (!archivo_salida.is_open()) {
+        cout << "Error: No se pudo abrir el archivo de salida: " << argv[4] << endl;
+        return 1;
+    }
+
+    MotorEspecies motor(especies);
+    motor.preparar(mundo);
+    motor.poblar();
+    Parametros params;
+
+    auto inicio = chrono::high_resolution_clock::now();
+    for (int gen = 0; gen < num_generaciones; gen++) {
+        motor.avanzar(params, gen);
+    }
+    auto fin = chrono::high_resolution_clock::now();
+
+    if (!silencioso) {
+        cout << "Generacion " << num_generaciones << ":";
+        for (size_t s = 0; s < especies.size(); s++) {
+            cout << " " << especies[s].nombre << "=" << motor.poblaciones[s].size();
+        }
+        cout << endl;
+    }
+
+    size_t num_objetos = num_rocas;
+    for (const Poblacion &p : motor.poblaciones) {
+        num_objetos += p.size();
+    }
+    archivo_salida << cabecera[0] << " " << cabecera[1] << " " << cabecera[2] << " " << 0 << " "
+                   << mundo.filas << " " << mundo.columnas << " " << num_objetos << "\n";
+    vector<const string *> palabras(MAX_ESPECIES + 2, nullptr);
+    for (size_t s = 0; s < especies.size(); s++) {
+        palabras[estado_de_especie(s)] = &especies[s].nombre;
+    }
+    string bufer;
     for (int i = 0; i < mundo.filas; i++) {
+        const uint8_t *fila = motor.estado.fila(i);
         for (int j = 0; j < mundo.columnas; j++) {
-            // Limpiar zorros del mundo
-            if (mundo.matriz[i][j] == CONEJO) {
-                mundo.matriz[i][j] = VACIO;
+            if (fila[j] == ROCA) {
+                formatear_objeto(bufer, "ROCK", 4, i, j);
+            } else if (fila[j] != VACIO) {
+                formatear_objeto(bufer, palabras[fila[j]]->data(), palabras[fila[j]]->size(), i, j);
             }
-            // Actualizar zorros y matriz con los sobrevivientes
-            if (conejos_nuevos[i][j].edad_reproduccion != -1) {
-                #pragma omp critical
-                {
-                    conejos.push_back(conejos_nuevos[i][j]);
-                }
-                mundo.matriz[i][j] = CONEJO;
-            }
-            // Añadir los nuevos conejos por reproducción
-            if (hay_conejo_nuevo[i][j] && mundo.matriz[i][j] == VACIO) {
-                Conejo nuevo;
-                nuevo.x = i;
-                nuevo.y = j;
-                nuevo.edad_reproduccion = 0;
+        }
+        if (bufer.size() > (1 << 20)) {
+            archivo_salida.write(bufer.data(), bufer.size());
+            bufer.clear();
+        }
+    }
+    archivo_salida.write(bufer.data(), bufer.size());
+
+    chrono::duration<double> duracion = fin - inicio;
+    cout << "Tiempo de ejecucion: " << duracion.count() << " segundos" << endl;
+    return 0;
+}
+
+// Modo conjunto: un mismo mundo con muchos juegos de parámetros. El mundo se
+// lee una vez y cada ejecución parte de una copia. El archivo de parámetros
+// tiene una línea por juego con
+//   gen_proc_conejos gen_proc_zorros gen_comida_zorros [num_generaciones]
+// y cada campo puede ser un valor o un rango "a:b" o "a:b:paso", que se expande
+// al producto de todos los rangos de la línea. '#' empieza un comentario.
+bool leer_rango(const string &campo, vector<int> &valores) {
+    int a, b, paso = 1;
+    int leidos = sscanf(campo.c_str(), "%d:%d:%d", &a, &b, &paso);
+    if (leidos == 1) {
+        b = a;
+    }
+    if (leidos < 1 || paso < 1 || b < a) {
+        return false;
+    }
+    for (int v = a; v <= b; v += paso) {
+        valores.push_back(v);
+    }
+    return true;
+}
 
-                #pragma omp critical
-                {
-                    conejos.push_back(nuevo);
+bool leer_juegos_parametros(const string &ruta, const Parametros &base, vector<Parametros> &juegos) {
+    ifstream archivo(ruta);
+    if (!archivo.is_open()) {
+        cout << "Error: No se pudo abrir el archivo de parametros: " << ruta << endl;
+        return false;
+    }
+    string linea;
+    int numero = 0;
+    while (getline(archivo, linea)) {
+        numero++;
+        linea = linea.substr(0, linea.find('#'));
+        istringstream campos(linea);
+        vector<string> texto;
+        string campo;
+        while (campos >> campo) {
+            texto.push_back(campo);
+        }
+        if (texto.empty()) {
+            continue;
+        }
+        vector<int> valores[4];
+        bool valido = texto.size() == 3 || texto.size() == 4;
+        for (size_t c = 0; valido && c < texto.size(); c++) {
+            valido = leer_rango(texto[c], valores[c]);
+        }
+        if (!valido) {
+            cout << "Error: Linea " << numero << " de " << ruta << " no valida: " << linea << endl;
+            return false;
+        }
+        if (texto.size() == 3) {
+            valores[3].push_back(base.num_generaciones);
+        }
+        for (int conejos : valores[0]) {
+            for (int zorros : valores[1]) {
+                for (int comida : valores[2]) {
+                    for (int generaciones : valores[3]) {
+                        Parametros params = base;
+                        params.gen_proc_conejos = conejos;
+                        params.gen_proc_zorros = zorros;
+                        params.gen_comida_zorros = comida;
+                        params.num_generaciones = generaciones;
+                        juegos.push_back(params);
+                    }
                 }
-                mundo.matriz[i][j] = CONEJO;
             }
         }
     }
-    
+    return true;
 }
 
-void mover_zorros(Mundo &mundo, vector<Zorro> &zorros, vector<Conejo> &conejos, const Parametros &params, int generacion_actual, vector<vector<Zorro>> &zorros_nuevos) {
-    vector<vector<bool>> hay_zorro_nuevo(mundo.filas, vector<bool>(mundo.columnas, false));
-    vector<pair<int, int>> conejos_eliminar;
-    
-    #pragma omp parallel 
-    {
-        vector<pair<int, int>> conejos_eliminar_local;
-        
-        // Mejora: usar planificación dinámica para mejor balance de carga
-        #pragma omp for schedule(dynamic, 8)
-        for (int i = 0; i < zorros.size(); i++) {
-            int x_viejo = zorros[i].x;
-            int y_viejo = zorros[i].y;
+struct ResultadoEjecucion {
+    size_t conejos = 0;
+    size_t zorros = 0;
+    double segundos = 0;
+};
 
-            // Buscar celdas adyacentes
-            vector<pair<int, int>> celdas_con_conejos = obtener_celdas_adyacentes(x_viejo, y_viejo, mundo, CONEJO);
-            vector<pair<int, int>> celdas_adyacentes = obtener_celdas_adyacentes(x_viejo, y_viejo, mundo, VACIO);
+// Ejecuta un juego de parámetros sobre una copia del mundo con el equipo de
+// hilos que tenga el hilo que la llama
+ResultadoEjecucion ejecutar_juego(const Mundo &mundo, const vector<Conejo> &conejos, const vector<Zorro> &zorros,
+                                  Parametros params, int generacion_inicial) {
+    params.num_hilos = omp_get_max_threads();
+    ResultadoEjecucion resultado;
+    double inicio = omp_get_wtime();
+    unique_ptr<Motor> motor = crear_motor(params);
+    motor->cargar(mundo, conejos, zorros);
+    for (int gen = generacion_inicial; gen < params.num_generaciones; gen++) {
+        motor->avanzar(params, gen);
+    }
+    Mundo final;
+    motor->exportar_celdas(final, resultado.conejos, resultado.zorros);
+    resultado.segundos = omp_get_wtime() - inicio;
+    return resultado;
+}
 
-            bool comio = false;
-            bool murio = false;
-            int x_nuevo = x_viejo;
-            int y_nuevo = y_viejo;
+int main_conjunto(int argc, char* argv[]) {
+    Parametros base;
+    Opciones opciones;
+    // Las opciones empiezan en argv[4], como en la ejecución normal en argv[3]
+    if (!leer_opciones(argc - 1, argv + 1, base, opciones)) {
+        return 1;
+    }
+    if (base.motor == MOTOR_DISTRIBUIDO) {
+        cout << "Error: El modo conjunto reparte las ejecuciones entre hilos; usa un motor de memoria compartida" << endl;
+        return 1;
+    }
 
-            // Intentar comer conejo
-            if (!celdas_con_conejos.empty()) {
-                pair<int, int> destino = seleccionar_celda_destino(x_viejo, y_viejo, celdas_con_conejos, generacion_actual);
-                x_nuevo = destino.first;
-                y_nuevo = destino.second;
-                zorros[i].hambre = 0;  // comió
-                comio = true;
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    int num_rocas = 0;
+    int generacion_inicial = 0;
+    string error = cargar_entrada(argv[2], mundo, conejos, zorros, base, num_rocas, generacion_inicial);
+    if (!error.empty()) {
+        cout << "Error: " << error << endl;
+        return 1;
+    }
+
+    vector<Parametros> juegos;
+    if (!leer_juegos_parametros(argv[3], base, juegos)) {
+        return 1;
+    }
+    for (const Parametros &params : juegos) {
+        error = validar_parametros(params, mundo);
+        if (!error.empty()) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+    }
 
-                // Almacena el lugar del conejo para eliminar
-                conejos_eliminar_local.push_back(make_pair(x_nuevo, y_nuevo));
+    // Reparto adaptativo: mientras haya al menos una ejecución por hilo, cada
+    // hilo hace ejecuciones completas con un solo hilo. Las que sobran se
+    // reparten en equipos anidados que se dividen los hilos libres.
+    int num_hilos = omp_get_max_threads();
+    size_t num_juegos = juegos.size();
+    size_t completas = num_juegos / num_hilos * num_hilos;
+    vector<ResultadoEjecucion> resultados(num_juegos);
+    omp_set_max_active_levels(2);
+    double inicio = omp_get_wtime();
 
-            } else {
-                zorros[i].hambre++;
-                // Si no comió, revisar si muere de hambre
-                if (zorros[i].hambre >= params.gen_comida_zorros) {
-                    murio = true;
-                } else if (!celdas_adyacentes.empty()) {
-                    // Moverse a una celda vacía
-                    pair<int, int> destino = seleccionar_celda_destino(x_viejo, y_viejo, celdas_adyacentes, generacion_actual);
-                    x_nuevo = destino.first;
-                    y_nuevo = destino.second;
-                }
-            }
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(num_hilos)
+    for (size_t k = 0; k < completas; k++) {
+        omp_set_num_threads(1);
+        resultados[k] = ejecutar_juego(mundo, conejos, zorros, juegos[k], generacion_inicial);
+    }
 
-            if (!murio) {
-                // Verificar reproducción
-                bool puede_reproducirse = (zorros[i].edad_reproduccion >= params.gen_proc_zorros);
+    int restantes = num_juegos - completas;
+    if (restantes > 0) {
+        int por_equipo = num_hilos / restantes;
+        #pragma omp parallel for schedule(static, 1) num_threads(restantes)
+        for (int r = 0; r < restantes; r++) {
+            // Los primeros equipos se quedan con los hilos que no dividen exacto
+            omp_set_num_threads(por_equipo + (r < num_hilos % restantes));
+            resultados[completas + r] = ejecutar_juego(mundo, conejos, zorros, juegos[completas + r], generacion_inicial);
+        }
+    }
+    double total = omp_get_wtime() - inicio;
 
-                if (puede_reproducirse && (x_nuevo != x_viejo || y_nuevo != y_viejo)){
-                    hay_zorro_nuevo[x_viejo][y_viejo] = true;
-                    zorros[i].edad_reproduccion = 0;
-                } else {
-                    zorros[i].edad_reproduccion++;
-                }
+    cout << "juego,gen_proc_conejos,gen_proc_zorros,gen_comida_zorros,generaciones,conejos,zorros,segundos\n";
+    for (size_t k = 0; k < num_juegos; k++) {
+        const Parametros &p = juegos[k];
+        cout << k << "," << p.gen_proc_conejos << "," << p.gen_proc_zorros << "," << p.gen_comida_zorros << ","
+             << p.num_generaciones << "," << resultados[k].conejos << "," << resultados[k].zorros << ","
+             << resultados[k].segundos << "\n";
+    }
+    cerr << num_juegos << " ejecuciones en " << total << " segundos con " << num_hilos << " hilos" << endl;
+    return 0;
+}
 
-                // Mover zorro
-                zorros[i].x = x_nuevo;
-                zorros[i].y = y_nuevo;
+// Servicio de simulación en un socket Unix. El proceso se queda vivo con el
+// equipo de hilos de OpenMP ya creado y los mundos leídos en caché, así un
+// trabajo pequeño no paga el arranque ni la lectura del archivo. Cada conexión
+// manda una línea y recibe una línea de respuesta:
+//   SIMULAR entrada salida [opciones]  ->  OK conejos zorros segundos
+//   CARGAR entrada                     ->  OK filas columnas
+//   OLVIDAR entrada | ESTADO | TERMINAR
+// Las opciones son las de la línea de órdenes salvo --modo=controles y
+// --medidas; los parámetros de la entrada se usan salvo que se pase --parametros. Las rutas son relativas al directorio del
+// servicio. Los trabajos se atienden de uno en uno y cada uno usa todos los hilos.
+struct MundoCacheado {
+    Mundo mundo;
+    vector<Conejo> conejos;
+    vector<Zorro> zorros;
+    Parametros params;
+    int num_rocas = 0;
+    int generacion_inicial = 0;
+    time_t modificado = 0;
+};
 
-                // Mejora: reducir la sección crítica
-                #pragma omp critical(zorros_nuevos)
-                {
-                    if (zorros_nuevos[x_nuevo][y_nuevo].edad_reproduccion != -1) {
-                        Zorro &otro = zorros_nuevos[x_nuevo][y_nuevo];
-                        if (zorros[i].edad_reproduccion > otro.edad_reproduccion ||
-                          (zorros[i].edad_reproduccion == otro.edad_reproduccion && zorros[i].hambre < otro.hambre)) {
-                            zorros_nuevos[x_nuevo][y_nuevo] = zorros[i];
-                        }
-                    } else {
-                        zorros_nuevos[x_nuevo][y_nuevo] = zorros[i];
-                    }
-                }
-                
-            }
+// Tiempo que una conexión puede tardar en mandar su línea entera o en leer la
+// respuesta; los trabajos se atienden de uno en uno y uno parado bloquearía al resto
+const int SEGUNDOS_CONEXION = 5;
+// Longitud máxima de la línea de petición
+const size_t MAX_LINEA_PETICION = 4096;
+
+class ServicioSimulacion {
+public:
+    int ejecutar(const string &ruta_socket) {
+        int servidor = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un direccion = {};
+        direccion.sun_family = AF_UNIX;
+        if (servidor == -1 || ruta_socket.size() >= sizeof(direccion.sun_path)) {
+            cout << "Error: No se pudo crear el socket: " << ruta_socket << endl;
+            return 1;
         }
-        
-        if(!conejos_eliminar_local.empty()){
-            // Unir la lista locale de conejos a eliminar
-            #pragma omp critical(conejos_eliminar)
-            {
-                conejos_eliminar.insert(conejos_eliminar.end(), conejos_eliminar_local.begin(), conejos_eliminar_local.end());
-            }
+        strcpy(direccion.sun_path, ruta_socket.c_str());
+        unlink(ruta_socket.c_str());
+        if (bind(servidor, reinterpret_cast<sockaddr *>(&direccion), sizeof(direccion)) == -1 || listen(servidor, 16) == -1) {
+            cout << "Error: No se pudo escuchar en " << ruta_socket << ": " << strerror(errno) << endl;
+            close(servidor);
+            return 1;
         }
-    }
-    
-    for (int i = 0; i < conejos_eliminar.size(); i++) { 
-        int x = conejos_eliminar[i].first;
-        int y = conejos_eliminar[i].second;
-        int bandera = 0;
-        for (int j = 0; j < conejos.size() && bandera == 0; j++) {       
-            if (conejos[j].x == x && conejos[j].y == y) {
-                conejos[j] = conejos[conejos.size() - 1]; // Reemplaza al conejo eliminado
-                conejos.pop_back();                       // Lo borra del final
-                bandera = 1;
+        cout << "Servicio escuchando en " << ruta_socket << " con " << omp_get_max_threads() << " hilos" << endl;
+
+        bool seguir = true;
+        while (seguir) {
+            int cliente = accept(servidor, nullptr, nullptr);
+            if (cliente == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            timeval espera = {SEGUNDOS_CONEXION, 0};
+            setsockopt(cliente, SOL_SOCKET, SO_SNDTIMEO, &espera, sizeof(espera));
+            string peticion;
+            string respuesta;
+            switch (leer_peticion(cliente, peticion)) {
+                case PETICION_COMPLETA: respuesta = atender(peticion, seguir); break;
+                case PETICION_LARGA: respuesta = "ERROR peticion demasiado larga"; break;
+                default: respuesta = "ERROR peticion incompleta"; break;
             }
+            respuesta += "\n";
+            send(cliente, respuesta.data(), respuesta.size(), MSG_NOSIGNAL);
+            close(cliente);
         }
+        close(servidor);
+        unlink(ruta_socket.c_str());
+        return 0;
     }
-    
-    zorros.clear();
 
-    #pragma omp parallel for collapse(2)
-    for (int i = 0; i < mundo.filas; i++) {
-        for (int j = 0; j < mundo.columnas; j++) {
-            // Limpiar zorros del mundo
-            if (mundo.matriz[i][j] == ZORRO) {
-                mundo.matriz[i][j] = VACIO;
+private:
+    map<string, MundoCacheado> cache;
+
+    enum ResultadoLectura { PETICION_COMPLETA, PETICION_INCOMPLETA, PETICION_LARGA };
+
+    // Lee una línea con un plazo para toda la petición, no por lectura: un
+    // cliente que manda un byte de vez en cuando también se corta
+    ResultadoLectura leer_peticion(int cliente, string &peticion) {
+        auto limite = chrono::steady_clock::now() + chrono::seconds(SEGUNDOS_CONEXION);
+        char bloque[256];
+        while (true) {
+            auto restante = chrono::duration_cast<chrono::milliseconds>(limite - chrono::steady_clock::now()).count();
+            if (restante <= 0) {
+                return PETICION_INCOMPLETA;
             }
-            // Actualizar zorros y matriz con los sobrevivientes
-            if (zorros_nuevos[i][j].edad_reproduccion != -1) {
-                #pragma omp critical
-                {
-                    zorros.push_back(zorros_nuevos[i][j]);
-                }
-                mundo.matriz[i][j] = ZORRO;
+            pollfd espera = {cliente, POLLIN, 0};
+            int listo = poll(&espera, 1, (int)restante);
+            if (listo == -1 && errno == EINTR) {
+                continue;
             }
-            // Añadir los nuevos zorros por reproducción
-            if (mundo.matriz[i][j] == VACIO && hay_zorro_nuevo[i][j]) {
-                Zorro nuevo;
-                nuevo.x = i;
-                nuevo.y = j;
-                nuevo.edad_reproduccion = 0;
-                nuevo.hambre = 0;
-                #pragma omp critical
-                {
-                    zorros.push_back(nuevo);
-                }
-                mundo.matriz[i][j] = ZORRO;
+            if (listo <= 0) {
+                return PETICION_INCOMPLETA;
+            }
+            ssize_t leidos = read(cliente, bloque, sizeof(bloque));
+            if (leidos <= 0) {
+                return PETICION_INCOMPLETA;
+            }
+            // Lo que venga tras el salto de línea se descarta
+            const char *fin = (const char *)memchr(bloque, '\n', leidos);
+            peticion.append(bloque, fin ? fin - bloque : leidos);
+            if (peticion.size() > MAX_LINEA_PETICION) {
+                return PETICION_LARGA;
+            }
+            if (fin) {
+                return PETICION_COMPLETA;
             }
         }
     }
-    
-}
 
-void imprimir_mundo(const Mundo &mundo, int generacion) {
-    cout << "Generacion " << generacion << endl;
-    cout << string(mundo.columnas * 2 + 1, '-') << endl;
-    
-    for (int i = 0; i < mundo.filas; i++) {
-        cout << "|";
-        for (int j = 0; j < mundo.columnas; j++) {
-            char simbolo;
-            switch (mundo.matriz[i][j]) {
-                case VACIO: simbolo = '.'; break;
-                case CONEJO: simbolo = 'R'; break;
-                case ZORRO: simbolo = 'F'; break;
-                case ROCA: simbolo = '*'; break;
-                default: simbolo = '?'; break;
-            }
-            cout << simbolo << " ";
+    // Devuelve el mundo en caché, leyéndolo si no está o si el archivo cambió
+    const MundoCacheado *obtener(const string &ruta, string &error) {
+        struct stat info;
+        if (stat(ruta.c_str(), &info) == -1) {
+            error = "No se pudo abrir el archivo de entrada: " + ruta;
+            return nullptr;
+        }
+        auto encontrado = cache.find(ruta);
+        if (encontrado != cache.end() && encontrado->second.modificado == info.st_mtime) {
+            return &encontrado->second;
+        }
+        MundoCacheado nuevo;
+        error = cargar_entrada(ruta, nuevo.mundo, nuevo.conejos, nuevo.zorros, nuevo.params,
+                               nuevo.num_rocas, nuevo.generacion_inicial);
+        if (!error.empty()) {
+            return nullptr;
         }
-        cout << "\b|" << endl;
+        nuevo.modificado = info.st_mtime;
+        return &(cache[ruta] = move(nuevo));
     }
-    
-    cout << string(mundo.columnas * 2 + 1, '-') << endl << endl;
-}
 
-void imprimir_estadisticas(int generacion, const vector<Conejo> &conejos, const vector<Zorro> &zorros) {
-    cout << "Generacion " << generacion << ":\n";
-    cout << " - Conejos: " << conejos.size() << "\n";
-    cout << " - Zorros : " << zorros.size() << "\n";
-    cout << "-------------------------" << endl;
-}
+    string atender(const string &peticion, bool &seguir) {
+        istringstream lectura(peticion);
+        vector<string> palabras;
+        string palabra;
+        while (lectura >> palabra) {
+            palabras.push_back(palabra);
+        }
+        if (palabras.empty()) {
+            return "ERROR peticion vacia";
+        }
 
-void mostrar_controles() {
-    cout << "\n--- CONTROLES ---\n";
-    cout << "p: Pausar/Reanudar\n";
-    cout << "+: Aumentar velocidad\n";
-    cout << "-: Disminuir velocidad\n";
-    cout << "q: Acabar la simulacion\n";
-    cout << "----------------\n";
-}
+        const string &orden = palabras[0];
+        string error;
+        if (orden == "TERMINAR") {
+            seguir = false;
+            return "OK";
+        }
+        if (orden == "ESTADO") {
+            return "OK " + to_string(cache.size()) + " mundos en cache, " + to_string(omp_get_max_threads()) + " hilos";
+        }
+        if (orden == "OLVIDAR" && palabras.size() == 2) {
+            return cache.erase(palabras[1]) ? "OK" : "ERROR no estaba en cache: " + palabras[1];
+        }
+        if (orden == "CARGAR" && palabras.size() == 2) {
+            const MundoCacheado *cacheado = obtener(palabras[1], error);
+            if (!cacheado) {
+                return "ERROR " + error;
+            }
+            return "OK " + to_string(cacheado->mundo.filas) + " " + to_string(cacheado->mundo.columnas);
+        }
+        if (orden != "SIMULAR" || palabras.size() < 3) {
+            return "ERROR peticion no valida: " + peticion;
+        }
 
+        const MundoCacheado *cacheado = obtener(palabras[1], error);
+        if (!cacheado) {
+            return "ERROR " + error;
+        }
+        // Mismas opciones que en la línea de órdenes, que empiezan en la cuarta palabra
+        Parametros params = cacheado->params;
+        params.num_hilos = omp_get_max_threads();
+        Opciones opciones;
+        vector<char *> argumentos;
+        for (string &p : palabras) {
+            argumentos.push_back(&p[0]);
+        }
+        ostringstream errores;
+        if (!leer_opciones(argumentos.size(), argumentos.data(), params, opciones, errores)) {
+            // "Error: motivo\n" de la línea de órdenes pasa a "ERROR motivo"
+            string motivo = errores.str();
+            motivo = motivo.substr(motivo.rfind("Error: ", 0) == 0 ? 7 : 0);
+            motivo = motivo.substr(0, motivo.find('\n'));
+            return "ERROR " + motivo;
+        }
+        // El servicio no tiene consola ni exporta medidas
+        if (opciones.modo == 1 || !opciones.medidas.empty()) {
+            return "ERROR el servicio no admite --modo=controles ni --medidas";
+        }
+        error = validar_parametros(params, cacheado->mundo);
+        if (!error.empty()) {
+            return "ERROR " + error;
+        }
 
-// Función para configurar la terminal para lectura sin bloqueo
-void configurar_terminal(struct termios &old_settings) {
-    struct termios new_settings;
-    tcgetattr(0, &old_settings);            // Guarda configuración actual del teclado
-    new_settings = old_settings;            // Crea una copia para modificar
-    new_settings.c_lflag &= ~ICANON;        // Desactiva modo canónico (no esperar ENTER)
-    new_settings.c_lflag &= ~ECHO;          // Desactiva eco (no mostrar lo que escribes)
-    new_settings.c_cc[VMIN] = 0;            // No requiere número mínimo de caracteres
-    new_settings.c_cc[VTIME] = 0;           // Sin tiempo de espera
-    tcsetattr(0, TCSANOW, &new_settings);   // Aplica los nuevos ajustes inmediatamente
-    fcntl(0, F_SETFL, O_NONBLOCK);          // Establece entrada estándar (0) como no bloqueante
-}
+        double inicio = omp_get_wtime();
+        Mundo mundo;
+        vector<Conejo> conejos;
+        vector<Zorro> zorros;
+        unique_ptr<Motor> motor = crear_motor(params);
+        motor->cargar(cacheado->mundo, cacheado->conejos, cacheado->zorros);
+        GrabadorTrayectoria grabador;
+        if (!opciones.trayectoria.empty()) {
+            if (!grabador.abrir(opciones.trayectoria, cacheado->mundo.filas, cacheado->mundo.columnas, opciones.cada)) {
+                return "ERROR no se pudo abrir el archivo de trayectoria: " + opciones.trayectoria;
+            }
+            grabador.registrar(cacheado->mundo, cacheado->generacion_inicial, cacheado->conejos.size(), cacheado->zorros.size());
+        }
+        PuntosControl puntos_control;
+        puntos_control.configurar(opciones.puntos_control, opciones.cada_control);
+        ejecutar_lote(*motor, mundo, conejos, zorros, params, cacheado->generacion_inicial, cacheado->num_rocas,
+                      grabador, puntos_control);
+        bool trayectoria_completa = grabador.cerrar();
+        puntos_control.esperar();
+        if (!trayectoria_completa) {
+            return "ERROR no se pudo escribir la trayectoria: " + opciones.trayectoria;
+        }
 
+        const string &salida = palabras[2];
+        bool escrito;
+        if (opciones.salida_binaria) {
+            escrito = escribir_instantanea(salida, mundo, conejos, zorros, params, params.num_generaciones, cacheado->num_rocas);
+        } else {
+            ofstream archivo_salida(salida);
+            imprimir_estado(archivo_salida, mundo, zorros, conejos, params, params.num_generaciones, cacheado->num_rocas);
+            escrito = archivo_salida.good();
+        }
+        if (!escrito) {
+            return "ERROR no se pudo escribir la salida: " + salida;
+        }
+        return "OK " + to_string(conejos.size()) + " " + to_string(zorros.size()) + " " + to_string(omp_get_wtime() - inicio);
+    }
+};
 
-// Restaura la configuración original de la terminal
-void restaurar_terminal(const struct termios &old_settings) {
-    tcsetattr(0, TCSANOW, &old_settings);  // Restaura los ajustes originales del teclado
-    fcntl(0, F_SETFL, 0);                  // Vuelve al modo bloqueante por defecto
-}
+// Manda una petición al servicio y escribe la respuesta
+int main_cliente(int argc, char* argv[]) {
+    sockaddr_un direccion = {};
+    direccion.sun_family = AF_UNIX;
+    string ruta_socket = argv[2];
+    int conexion = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conexion == -1 || ruta_socket.size() >= sizeof(direccion.sun_path)) {
+        cout << "Error: No se pudo crear el socket" << endl;
+        return 1;
+    }
+    strcpy(direccion.sun_path, ruta_socket.c_str());
+    if (connect(conexion, reinterpret_cast<sockaddr *>(&direccion), sizeof(direccion)) == -1) {
+        cout << "Error: No se pudo conectar con " << ruta_socket << ": " << strerror(errno) << endl;
+        close(conexion);
+        return 1;
+    }
+    string peticion;
+    for (int i = 3; i < argc; i++) {
+        peticion += (i > 3 ? " " : "") + string(argv[i]);
+    }
+    peticion += "\n";
+    send(conexion, peticion.data(), peticion.size(), MSG_NOSIGNAL);
 
-char procesar_input() {
-    char c;
-    if (read(0, &c, 1) < 1) {
-        return 0;  // No se presionó ninguna tecla
+    string respuesta;
+    char bloque[4096];
+    ssize_t leidos;
+    while ((leidos = read(conexion, bloque, sizeof(bloque))) > 0) {
+        respuesta.append(bloque, leidos);
     }
-    return c;     // Retorna el carácter presionado
+    close(conexion);
+    cout << respuesta;
+    return respuesta.rfind("OK", 0) == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
+    // Proceso de franja lanzado por el motor distribuido
+    if (argc == 5 && string(argv[1]) == "--franja") {
+        return main_franja(argv);
+    }
+
+    // Reproducción de una trayectoria grabada
+    if ((argc == 3 || (argc == 4 && string(argv[3]) == "--mostrar")) && string(argv[1]) == "--reproducir") {
+        return reproducir_trayectoria(argv[2], argc == 4);
+    }
+
+    // Banco de pruebas y generador de mundos
+    if (argc >= 2 && string(argv[1]) == "--banco") {
+        return main_banco(argc, argv);
+    }
+    if ((argc == 6 || argc == 7) && string(argv[1]) == "--generar") {
+        return generar_archivo(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--verificar") {
+        return main_verificacion(argc, argv);
+    }
+    if (argc >= 4 && string(argv[1]) == "--conjunto") {
+        return main_conjunto(argc, argv);
+    }
+    if (argc >= 5 && string(argv[1]) == "--especies") {
+        return main_especies(argc, argv);
+    }
+
+    // Servicio en un socket Unix y su cliente
+    if (argc == 3 && string(argv[1]) == "--servicio") {
+        ServicioSimulacion servicio;
+        return servicio.ejecutar(argv[2]);
+    }
+    if (argc >= 4 && string(argv[1]) == "--cliente") {
+        return main_cliente(argc, argv);
+    }
+
+    // Conversión entre el formato de texto y el binario
+    if (argc == 4 && string(argv[1]) == "--convertir") {
+        return convertir_formato(argv[2], argv[3]);
+    }
+
     int num_hilos = omp_get_max_threads();
     omp_set_num_threads(num_hilos);
 
+    if (argc < 3) {
+        cout << "Uso: " << argv[0] << " entrada salida [--motor=NOMBRE] [--procesos=N]" << endl;
+        cout << "     " << argv[0] << " --convertir origen destino" << endl;
+        cout << "     " << argv[0] << " --reproducir trayectoria [--mostrar]" << endl;
+        cout << "     " << argv[0] << " --generar filas columnas semilla destino [rocas,conejos,zorros]" << endl;
+        cout << "     " << argv[0] << " --banco [escalado|micro] [--motor=NOMBRE] [--tamanos=A,B] [--hilos=A,B]" << endl;
+        cout << "         [--generaciones=N] [--repeticiones=N] [--semilla=S] [--densidades=R,C,Z] [--parametros=C,Z,H]" << endl;
+        cout << "     " << argv[0] << " --conjunto entrada parametros [--motor=NOMBRE]" << endl;
+        cout << "     " << argv[0] << " --especies especies entrada salida [--generaciones=N] [--silencioso]" << endl;
+        cout << "     " << argv[0] << " --servicio socket" << endl;
+        cout << "     " << argv[0] << " --cliente socket SIMULAR entrada salida [opciones] | CARGAR entrada | ESTADO | TERMINAR" << endl;
+        cout << "     " << argv[0] << " --verificar [--casos=N] [--semilla=S] [--tamano=N] [--generaciones=N]" << endl;
+        cout << "         [--hilos=A,B] [--motores=A,B]" << endl;
+        cout << "Opciones: --parametros=C,Z,H,G --modo=controles|inmediato no preguntan en consola" << endl;
+        cout << "         --formato=texto|binario --silencioso" << endl;
+        cout << "         --vecindad=von-neumann|moore --contorno=acotado|toroidal (motores entidades y referencia)" << endl;
+        cout << "         --trayectoria=ARCHIVO --cada=N graba el mundo cada N generaciones" << endl;
+        cout << "         --puntos-control=ARCHIVO --cada-control=N guarda una instantanea cada N generaciones" << endl;
+        cout << "         --medidas=ARCHIVO exporta tiempos y contadores en JSON (compilado con -DINSTRUMENTACION)" << endl;
+        cout << "La entrada puede estar en texto o en el formato binario de instantanea; una" << endl;
+        cout << "instantanea de un punto de control se reanuda desde su generacion" << endl;
+        cout << "Motores:";
+        for (int m = 0; m < NUM_MOTORES; m++) {
+            cout << " " << NOMBRES_MOTORES[m];
+        }
+        cout << endl;
+        return 1;
+    }
+
     ifstream archivo_entrada(argv[1]);
     if (!archivo_entrada.is_open()) {
         cout << "Error: No se pudo abrir el archivo de entrada: " << argv[1] << endl;
@@ -498,11 +6239,18 @@ int main(int argc, char* argv[]) {
     Parametros params;
     params.num_hilos = num_hilos;
     int num_rocas = 0;
+    int generacion_inicial = 0;
+    Opciones opciones;
+    if (!leer_opciones(argc, argv, params, opciones)) {
+        return 1;
+    }
     
     // Iniciar parámetros
-    cout << "Deseas ajustar parametros? (s/n): ";
-    char opcion;
-    cin >> opcion;
+    char opcion = 'n';
+    if (!opciones.parametros) {
+        cout << "Deseas ajustar parametros? (s/n): ";
+        cin >> opcion;
+    }
     if (opcion == 's' || opcion == 'S') {
         cout << "Generaciones hasta que un conejo se reproduce: ";
         cin >> params.gen_proc_conejos;
@@ -514,39 +6262,88 @@ int main(int argc, char* argv[]) {
         cin >> params.num_generaciones;
     }
 
-    inicializar_mundo(archivo_entrada, mundo, conejos, zorros, params, num_rocas);
+    // Los motores disperso y de planos de bits, sin controles ni archivos que
+    // necesiten el mundo entero, no pasan nunca por la matriz densa
+    if (opciones.modo == 2 && !es_instantanea(argv[1]) && !opciones.salida_binaria
+        && opciones.trayectoria.empty() && opciones.puntos_control.empty() && opciones.medidas.empty()) {
+        if (params.motor == MOTOR_DISPERSO) {
+            return ejecutar_sin_mundo<MotorDisperso>(argv[1], archivo_salida, params, opciones);
+        }
+        if (params.motor == MOTOR_BITBOARD) {
+            return ejecutar_sin_mundo<MotorBitboard>(argv[1], archivo_salida, params, opciones);
+        }
+    }
+
+    string error = cargar_entrada(argv[1], mundo, conejos, zorros, params, num_rocas, generacion_inicial);
+    if (error.empty()) {
+        error = validar_parametros(params, mundo);
+    }
+    if (!error.empty()) {
+        cout << "Error: " << error << endl;
+        return 1;
+    }
+
+    unique_ptr<Motor> motor = crear_motor(params);
+    motor->cargar(mundo, conejos, zorros);
 
+#ifdef INSTRUMENTACION
+    if (!opciones.medidas.empty()) {
+        instrumentacion.iniciar(num_hilos);
+    }
+#endif
+
+    GrabadorTrayectoria grabador;
+    if (!opciones.trayectoria.empty()) {
+        if (!grabador.abrir(opciones.trayectoria, mundo.filas, mundo.columnas, opciones.cada)) {
+            cout << "Error: No se pudo abrir el archivo de trayectoria: " << opciones.trayectoria << endl;
+            return 1;
+        }
+        grabador.registrar(mundo, generacion_inicial, conejos.size(), zorros.size());
+    }
+
+    PuntosControl puntos_control;
+    puntos_control.configurar(opciones.puntos_control, opciones.cada_control);
     
-    vector<vector<Conejo>> conejos_nuevos(mundo.filas, vector<Conejo>(mundo.columnas));
-    vector<vector<Zorro>> zorros_nuevos(mundo.filas, vector<Zorro>(mundo.columnas));
-    
-    cout << "¿Desea ver la simulacion poco a poco usando controles de tiempo o ver de una vez la respuesta?: \n";
-    cout << "1. Simulacion con controles de tiempo\n";
-    cout << "2. Simulacion con respuesta inmediata\n";
-    cout << "Escriba el numero de la opcion: ";
-    int opcion2;
-    cin >> opcion2;
+    int opcion2 = opciones.modo;
+    if (opcion2 == 0) {
+        cout << "¿Desea ver la simulacion poco a poco usando controles de tiempo o ver de una vez la respuesta?: \n";
+        cout << "1. Simulacion con controles de tiempo\n";
+        cout << "2. Simulacion con respuesta inmediata\n";
+        cout << "Escriba el numero de la opcion: ";
+        cin >> opcion2;
+    }
     
     auto inicio = chrono::high_resolution_clock::now();
     if (opcion2 == 1) {
         bool pausado = false;
         int velocidad_ms = 600;
-        int gen = 0;
+        int gen = generacion_inicial;
         bool continuar = true;
         
         // Configurar terminal para entrada sin bloqueos
         struct termios old_settings;
         configurar_terminal(old_settings);
+        RenderizadorTerminal renderizador;
         
         while (gen < params.num_generaciones && continuar) {
+            // La velocidad marca la duración de cada generación, dibujo incluido
+            auto inicio_cuadro = chrono::steady_clock::now();
+
             // Procesar la generación actual
-            inicializar_edad(mundo, conejos_nuevos, zorros_nuevos);
-            mover_conejos(mundo, conejos, params, gen, conejos_nuevos);
-            mover_zorros(mundo, zorros, conejos, params, gen, zorros_nuevos);
+            INICIAR_FASE(FASE_GENERACION);
+            motor->avanzar(params, gen);
+            SINCRONIZAR(*motor);
+            TERMINAR_FASE(FASE_GENERACION);
+            motor->exportar(mundo, conejos, zorros);
+            if (grabador.toca(gen + 1, params.num_generaciones)) {
+                grabador.registrar(mundo, gen + 1, conejos.size(), zorros.size());
+            }
+            if (puntos_control.toca(gen + 1)) {
+                puntos_control.guardar(mundo, conejos, zorros, params, gen + 1, num_rocas);
+            }
             
             // Mostrar el estado actual
-            system("clear");
-            imprimir_mundo(mundo, gen);
+            renderizador.dibujar(mundo, gen);
             imprimir_estadisticas(gen, conejos, zorros);
             
             cout << "Velocidad: " << velocidad_ms << "ms | ";
@@ -580,6 +6377,11 @@ int main(int argc, char* argv[]) {
                 } else if (tecla == 'h' || tecla == 'H') {
                     mostrar_controles();
                 }
+                cout << flush;
+                // Los mensajes de las teclas se acumulan bajo el dibujo
+                if (tecla != 0) {
+                    renderizador.invalidar();
+                }
                 
                 if (!pausado && tecla != 0) {
                     bandera = 1;
@@ -589,7 +6391,11 @@ int main(int argc, char* argv[]) {
             } while (pausado && bandera == 0);
 
             if (!pausado && continuar) {
-                usleep(velocidad_ms * 1000);        
+                auto transcurrido = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - inicio_cuadro);
+                long long restante = velocidad_ms * 1000LL - transcurrido.count();
+                if (restante > 0) {
+                    usleep(restante);
+                }
             }
             gen++;
         }
@@ -597,20 +6403,39 @@ int main(int argc, char* argv[]) {
         // Restaurar la configuración de la terminal
         restaurar_terminal(old_settings);
         
-        system("clear");
+        cout << "\x1b[H\x1b[2J\x1b[3J" << flush;
     } else{
-
-        for (int gen = 0; gen < params.num_generaciones; gen++) {
-            inicializar_edad(mundo, conejos_nuevos, zorros_nuevos);
-            mover_conejos(mundo, conejos, params, gen, conejos_nuevos);
-            mover_zorros(mundo, zorros, conejos, params, gen, zorros_nuevos);
-        }
+        ejecutar_lote(*motor, mundo, conejos, zorros, params, generacion_inicial, num_rocas, grabador, puntos_control);
     }
 
-    imprimir_mundo(mundo, params.num_generaciones);
+    if (!opciones.silencioso) {
+        imprimir_mundo(mundo, params.num_generaciones);
+    }
     imprimir_estadisticas(params.num_generaciones, conejos, zorros);
 
-    imprimir_estado(archivo_salida, mundo, zorros, conejos, params, params.num_generaciones, num_rocas);
+    int codigo = 0;
+    if (opciones.salida_binaria) {
+        archivo_salida.close();
+        if (!escribir_instantanea(argv[2], mundo, conejos, zorros, params, params.num_generaciones, num_rocas)) {
+            cout << "Error: No se pudo escribir la instantanea: " << argv[2] << endl;
+            codigo = 1;
+        }
+    } else {
+        imprimir_estado(archivo_salida, mundo, zorros, conejos, params, params.num_generaciones, num_rocas);
+    }
+    if (!grabador.cerrar()) {
+        cout << "Error: No se pudo escribir la trayectoria: " << opciones.trayectoria << endl;
+        codigo = 1;
+    }
+    puntos_control.esperar();
+
+#ifdef INSTRUMENTACION
+    if (!opciones.medidas.empty()
+        && !instrumentacion.exportar_json(opciones.medidas, NOMBRES_MOTORES[params.motor], mundo.filas, mundo.columnas,
+                                          params.num_generaciones - generacion_inicial)) {
+        cout << "Error: No se pudo escribir el archivo de medidas: " << opciones.medidas << endl;
+    }
+#endif
 
     auto fin = chrono::high_resolution_clock::now();
     chrono::duration<double> duracion = fin - inicio;
@@ -619,5 +6444,5 @@ int main(int argc, char* argv[]) {
     archivo_entrada.close();
     archivo_salida.close();    
 
-    return 0;
+    return codigo;
 }